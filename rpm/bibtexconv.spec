@@ -14,8 +14,14 @@ BuildRequires: gcc-c++
 BuildRequires: bison
 BuildRequires: flex
 BuildRequires: openssl-devel
-BuildRequires: libcurl-devel
-Requires: file
+BuildRequires: libcurl-devel >= 7.68
+BuildRequires: file-devel
+BuildRequires: zlib-devel
+# liburing is optional; it is used if available:
+%if 0%{?fedora} || 0%{?rhel} >= 9
+BuildRequires: liburing-devel
+%endif
+Requires: file-libs
 Requires: libcurl
 Requires: openssl-libs
 Requires: poppler-utils
@@ -0,0 +1,578 @@
+// ==========================================================================
+//                ____  _ _   _____   __  ______
+//                | __ )(_) |_|_   _|__\ \/ / ___|___  _ ____   __
+//                |  _ \| | '_ \| |/ _ \  / |   / _ \| '_ \ \ / /
+//                | |_) | | |_) | |  __//  \ |__| (_) | | | \ V /
+//                |____/|_|_.__/|_|\___/_/\_\____\___/|_| |_|\_/
+//
+//                          ---  BibTeX Converter  ---
+//                   https://www.nntb.no/~dreibh/bibtexconv/
+// ==========================================================================
+//
+// BibTeX Converter
+// Copyright (C) 2010-2026 by Thomas Dreibholz
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Contact: thomas.dreibholz@gmail.com
+
+#include "batchwriter.h"
+#include "workerpool.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <atomic>
+
+
+// ###### Constructor #######################################################
+BatchWriter::BatchWriter(const bool onlyWriteChangedFiles)
+{
+   onlyChanged    = onlyWriteChangedFiles;
+   changedFiles   = 0;
+   unchangedFiles = 0;
+
+#ifdef HAVE_LIBURING
+   // Comparing with and replacing existing files is done by the workers:
+   ringAvailable = (!onlyChanged) &&
+                   (io_uring_queue_init(QueueDepth, &ring, 0) == 0);
+   if(ringAvailable) {
+      // Creating and closing files via io_uring needs Linux 5.6 or newer:
+      struct io_uring_probe* probe = io_uring_get_probe_ring(&ring);
+      if( (probe == nullptr) ||
+          (!io_uring_opcode_supported(probe, IORING_OP_OPENAT)) ||
+          (!io_uring_opcode_supported(probe, IORING_OP_WRITEV)) ||
+          (!io_uring_opcode_supported(probe, IORING_OP_CLOSE)) ) {
+         io_uring_queue_exit(&ring);
+         ringAvailable = false;
+      }
+      if(probe != nullptr) {
+         io_uring_free_probe(probe);
+      }
+   }
+#endif
+}
+
+
+// ###### Destructor ########################################################
+BatchWriter::~BatchWriter()
+{
+#ifdef HAVE_LIBURING
+   if(ringAvailable) {
+      io_uring_queue_exit(&ring);
+   }
+#endif
+}
+
+
+// ###### Prepare I/O vectors for header and content ########################
+static unsigned int prepareIOVecs(const OutputFile& file,
+                                  struct iovec*     iov,
+                                  size_t            skip)
+{
+   unsigned int count = 0;
+   const size_t headerLength = (file.Header != nullptr) ? strlen(file.Header) : 0;
+   if(skip < headerLength) {
+      iov[count].iov_base = (void*)&file.Header[skip];
+      iov[count].iov_len  = headerLength - skip;
+      count++;
+      skip = 0;
+   }
+   else {
+      skip -= headerLength;
+   }
+   if(skip < file.Content->size()) {
+      iov[count].iov_base = (void*)&file.Content->data()[skip];
+      iov[count].iov_len  = file.Content->size() - skip;
+      count++;
+   }
+   return count;
+}
+
+
+// ###### Write (remaining) header and content into file ####################
+static int writeFileData(const int fd, const OutputFile& file, size_t written)
+{
+   struct iovec iov[2];
+   unsigned int count;
+   while( (count = prepareIOVecs(file, iov, written)) > 0 ) {
+      const ssize_t result = pwritev(fd, iov, count, written);
+      if(result < 0) {
+         if(errno == EINTR) {
+            continue;
+         }
+         return errno;
+      }
+      written += result;
+   }
+   return 0;
+}
+
+
+// ###### Check whether a file has exactly the given content ################
+static bool hasContent(const char*         fileName,
+                       const struct iovec* iov,
+                       const unsigned int  count)
+{
+   size_t size = 0;
+   for(unsigned int i = 0; i < count; i++) {
+      size += iov[i].iov_len;
+   }
+
+   const int fd = open(fileName, O_RDONLY|O_CLOEXEC);
+   if(fd < 0) {
+      return false;
+   }
+   bool        same = false;
+   struct stat status;
+   if( (fstat(fd, &status) == 0) && (S_ISREG(status.st_mode)) &&
+       ((size_t)status.st_size == size) ) {
+      if(size == 0) {
+         same = true;
+      }
+      else {
+         const char* data = (const char*)mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+         if(data != MAP_FAILED) {
+            same = true;
+            size_t offset = 0;
+            for(unsigned int i = 0; i < count; i++) {
+               if(memcmp(&data[offset], iov[i].iov_base, iov[i].iov_len) != 0) {
+                  same = false;
+                  break;
+               }
+               offset += iov[i].iov_len;
+            }
+            munmap((void*)data, size);
+         }
+      }
+   }
+   close(fd);
+   return same;
+}
+
+
+// ###### Check whether two files have the same content #####################
+static bool haveSameContent(const char* fileName1, const char* fileName2)
+{
+   const int fd = open(fileName1, O_RDONLY|O_CLOEXEC);
+   if(fd < 0) {
+      return false;
+   }
+   bool        same = false;
+   struct stat status;
+   if(fstat(fd, &status) == 0) {
+      struct iovec iov;
+      iov.iov_len  = status.st_size;
+      iov.iov_base = nullptr;
+      if(iov.iov_len == 0) {
+         same = hasContent(fileName2, &iov, 0);
+      }
+      else {
+         iov.iov_base = mmap(nullptr, iov.iov_len, PROT_READ, MAP_PRIVATE, fd, 0);
+         if(iov.iov_base != MAP_FAILED) {
+            same = hasContent(fileName2, &iov, 1);
+            munmap(iov.iov_base, iov.iov_len);
+         }
+      }
+   }
+   close(fd);
+   return same;
+}
+
+
+// ###### Create temporary file next to the given file ######################
+// The file is created with mode 0666, i.e. the kernel applies the umask like
+// for files made by fopen(). The name is unique within the process.
+static int createTemporaryFile(const std::string& fileName,
+                               std::string&       temporaryFileName)
+{
+   static std::atomic<unsigned int> counter(0);
+   int                              fd;
+   do {
+      temporaryFileName = fileName + "." + std::to_string(getpid()) +
+                             "-" + std::to_string(counter++);
+      fd = open(temporaryFileName.c_str(),
+                O_WRONLY|O_CREAT|O_EXCL|O_CLOEXEC, 0666);
+   } while( (fd < 0) && (errno == EEXIST) );
+   return fd;
+}
+
+
+// ###### Get the file to be replaced, following symbolic links ############
+// A symbolic link is kept; the file it refers to is replaced instead.
+static std::string getTargetFileName(const std::string& fileName)
+{
+   struct stat status;
+   if( (lstat(fileName.c_str(), &status) == 0) && (S_ISLNK(status.st_mode)) ) {
+      char* target = realpath(fileName.c_str(), nullptr);
+      if(target != nullptr) {
+         const std::string targetFileName(target);
+         free(target);
+         return targetFileName;
+      }
+   }
+   return fileName;
+}
+
+
+// ###### Give temporary file the attributes of the file to be replaced ####
+// Like when overwriting the file in place, its permissions, owner and group
+// are kept (as far as permitted).
+static void copyFileAttributes(const int fd, const std::string& targetFileName)
+{
+   struct stat status;
+   if(stat(targetFileName.c_str(), &status) == 0) {
+      if( (fchown(fd, status.st_uid, status.st_gid) != 0) &&
+          (fchown(fd, (uid_t)-1, status.st_gid) != 0) ) {
+         // Not permitted -> the file gets the user's owner and group.
+      }
+      fchmod(fd, status.st_mode & 07777);
+   }
+}
+
+
+// ###### Write files ######################################################
+// Returns false, if any file could not be written. All files of the batch
+// are tried, and an error message is printed for each failed file.
+bool BatchWriter::write(std::vector<OutputFile>& files)
+{
+   for(OutputFile& file : files) {
+      file.Error   = 0;
+      file.Created = false;
+      file.Changed = true;
+   }
+
+#ifdef HAVE_LIBURING
+   if(ringAvailable) {
+      writeWithIOURing(files);
+   }
+   else
+#endif
+   writeWithWorkers(files);
+
+   bool success = true;
+   for(const OutputFile& file : files) {
+      if(file.Error != 0) {
+         if(!file.Created) {
+            fprintf(stderr, "ERROR: Unable to create %s file %s!\n",
+                    file.FormatName, file.FileName.c_str());
+         }
+         else {
+            fprintf(stderr, "ERROR: Unable to write %s file %s: %s!\n",
+                    file.FormatName, file.FileName.c_str(), strerror(file.Error));
+         }
+         success = false;
+      }
+      else if(file.Changed) {
+         changedFiles++;
+      }
+      else {
+         unchangedFiles++;
+      }
+   }
+   return success;
+}
+
+
+// ###### Write files using worker threads ##################################
+void BatchWriter::writeWithWorkers(std::vector<OutputFile>& files)
+{
+   runInParallel(files.size(), [&](const size_t index) {
+      writeFile(files[index]);
+   });
+}
+
+
+// ###### Write a single file synchronously #################################
+void BatchWriter::writeFile(OutputFile& file)
+{
+   // ====== Write into the file directly ===================================
+   if(!onlyChanged) {
+      const int fd = open(file.FileName.c_str(),
+                          O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0666);
+      if(fd < 0) {
+         file.Error = errno;
+         return;
+      }
+      file.Created = true;
+      file.Error   = writeFileData(fd, file, 0);
+      if( (close(fd) != 0) && (file.Error == 0) ) {
+         file.Error = errno;
+      }
+      return;
+   }
+
+   // ====== Keep an unchanged file =========================================
+   struct iovec       iov[2];
+   const unsigned int count = prepareIOVecs(file, iov, 0);
+   if(hasContent(file.FileName.c_str(), iov, count)) {
+      file.Created = true;
+      file.Changed = false;
+      return;
+   }
+
+   // ====== Replace a changed file =========================================
+   const std::string targetFileName = getTargetFileName(file.FileName);
+   std::string       temporaryFileName;
+   const int         fd = createTemporaryFile(targetFileName, temporaryFileName);
+   if(fd < 0) {
+      file.Error = errno;
+      return;
+   }
+   file.Created = true;
+   file.Error   = writeFileData(fd, file, 0);
+   copyFileAttributes(fd, targetFileName);
+   if( (close(fd) != 0) && (file.Error == 0) ) {
+      file.Error = errno;
+   }
+   if( (file.Error == 0) &&
+       (rename(temporaryFileName.c_str(), targetFileName.c_str()) != 0) ) {
+      file.Error = errno;
+   }
+   if(file.Error != 0) {
+      unlink(temporaryFileName.c_str());
+   }
+}
+
+
+// ###### Create a combined file ###########################################
+// With onlyWriteChangedFiles, a temporary file is created, which replaces
+// the original file in closeCombinedFile() if the content has changed.
+FILE* BatchWriter::openCombinedFile(const char*  fileName,
+                                    const char*  formatName,
+                                    std::string& temporaryFileName)
+{
+   FILE* fh = nullptr;
+   temporaryFileName.clear();
+   if(onlyChanged) {
+      const int fd = createTemporaryFile(getTargetFileName(fileName), temporaryFileName);
+      if(fd >= 0) {
+         fh = fdopen(fd, "w");
+         if(fh == nullptr) {
+            close(fd);
+            unlink(temporaryFileName.c_str());
+         }
+      }
+   }
+   else {
+      fh = fopen(fileName, "w");
+   }
+   if(fh == nullptr) {
+      fprintf(stderr, "ERROR: Unable to create %s file %s!\n", formatName, fileName);
+   }
+   return fh;
+}
+
+
+// ###### Close a combined file #############################################
+bool BatchWriter::closeCombinedFile(FILE*              fh,
+                                    const char*        fileName,
+                                    const char*        formatName,
+                                    const std::string& temporaryFileName)
+{
+   const std::string targetFileName = getTargetFileName(fileName);
+   if(!temporaryFileName.empty()) {
+      copyFileAttributes(fileno(fh), targetFileName);
+   }
+   bool success = (ferror(fh) == 0);
+   if(fclose(fh) != 0) {
+      success = false;
+   }
+
+   if(success) {
+      if(temporaryFileName.empty()) {
+         changedFiles++;
+         return true;
+      }
+      if(haveSameContent(temporaryFileName.c_str(), fileName)) {
+         unlink(temporaryFileName.c_str());
+         unchangedFiles++;
+         return true;
+      }
+      if(rename(temporaryFileName.c_str(), targetFileName.c_str()) == 0) {
+         changedFiles++;
+         return true;
+      }
+   }
+
+   fprintf(stderr, "ERROR: Unable to write %s file %s: %s!\n",
+           formatName, fileName, strerror(errno));
+   if(!temporaryFileName.empty()) {
+      unlink(temporaryFileName.c_str());
+   }
+   return false;
+}
+
+
+#ifdef HAVE_LIBURING
+// ###### Submit prepared requests and wait for their completions ##########
+// The result of each completed request is stored in results[user data].
+// Returns false if the ring failed; requests not completed then remain
+// Pending, since it is unknown whether the kernel still processes them.
+bool BatchWriter::submitAndWait(const unsigned int prepared,
+                                std::vector<int>&  results)
+{
+   const int submitted = io_uring_submit(&ring);
+   bool      success   = (submitted == (int)prepared);
+   for(int c = 0; c < submitted; c++) {
+      struct io_uring_cqe* cqe;
+      if(io_uring_wait_cqe(&ring, &cqe) < 0) {
+         return false;
+      }
+      results[(uintptr_t)io_uring_cqe_get_data(cqe)] = cqe->res;
+      io_uring_cqe_seen(&ring, cqe);
+   }
+   return success;
+}
+
+
+// ###### Write files using io_uring ########################################
+// Each chunk of files is handled in two submissions: first, all files are
+// created (openat); then, for each created file, a write linked to a close.
+// A short write breaks the link, so the rest is written synchronously and
+// the file is closed afterwards.
+//
+// If the ring fails, it is torn down, and the remaining files are written
+// by the worker threads. A descriptor which may still be used by a pending
+// request is neither closed nor written; its file is written again by name.
+void BatchWriter::writeWithIOURing(std::vector<OutputFile>& files)
+{
+   static const int          NotQueued = INT_MIN;
+   static const int          Pending   = INT_MIN + 1;
+   const size_t              chunkSize = QueueDepth / 2;
+   std::vector<int>          results;   // openat, then write/close pairs
+   std::vector<struct iovec> iovs;
+   std::vector<OutputFile*>  remaining;
+   results.reserve(3 * chunkSize);
+   iovs.reserve(2 * chunkSize);
+
+   for(size_t chunkStart = 0; chunkStart < files.size(); chunkStart += chunkSize) {
+      const size_t chunkFiles = std::min(chunkSize, files.size() - chunkStart);
+      results.assign(3 * chunkFiles, NotQueued);
+      iovs.assign(2 * chunkFiles, iovec());
+      int* fds = results.data();
+
+      // ====== Create the files ============================================
+      unsigned int prepared = 0;
+      bool         success  = true;
+      for(size_t i = 0; i < chunkFiles; i++) {
+         struct io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+         if(sqe == nullptr) {
+            success = false;
+            break;
+         }
+         io_uring_prep_openat(sqe, AT_FDCWD, files[chunkStart + i].FileName.c_str(),
+                              O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0666);
+         io_uring_sqe_set_data(sqe, (void*)(uintptr_t)i);
+         fds[i] = Pending;
+         prepared++;
+      }
+      success = submitAndWait(prepared, results) && success;
+
+      // ====== Write and close the files ===================================
+      if(success) {
+         prepared = 0;
+         for(size_t i = 0; i < chunkFiles; i++) {
+            if(fds[i] < 0) {
+               continue;
+            }
+            struct io_uring_sqe* writeSQE =
+               (io_uring_sq_space_left(&ring) >= 2) ? io_uring_get_sqe(&ring) : nullptr;
+            struct io_uring_sqe* closeSQE =
+               (writeSQE != nullptr) ? io_uring_get_sqe(&ring) : nullptr;
+            if(closeSQE == nullptr) {
+               if(writeSQE != nullptr) {
+                  io_uring_prep_nop(writeSQE);
+               }
+               success = false;
+               break;
+            }
+            const size_t       writeIndex = chunkFiles + 2 * i;
+            const unsigned int count      = prepareIOVecs(files[chunkStart + i],
+                                                          &iovs[2 * i], 0);
+            io_uring_prep_writev(writeSQE, fds[i], &iovs[2 * i], count, 0);
+            io_uring_sqe_set_flags(writeSQE, IOSQE_IO_LINK);
+            io_uring_sqe_set_data(writeSQE, (void*)(uintptr_t)writeIndex);
+            io_uring_prep_close(closeSQE, fds[i]);
+            io_uring_sqe_set_data(closeSQE, (void*)(uintptr_t)(writeIndex + 1));
+            results[writeIndex] = results[writeIndex + 1] = Pending;
+            prepared += 2;
+         }
+         success = submitAndWait(prepared, results) && success;
+      }
+
+      // ====== Check the results ===========================================
+      for(size_t i = 0; i < chunkFiles; i++) {
+         OutputFile& file        = files[chunkStart + i];
+         const int   writeResult = results[chunkFiles + 2 * i];
+         const int   closeResult = results[chunkFiles + 2 * i + 1];
+         if( (fds[i] == NotQueued) || (fds[i] == Pending) ||
+             (closeResult == Pending) ) {
+            // The file (or its descriptor) is in an unknown state:
+            remaining.push_back(&file);
+            continue;
+         }
+         if(fds[i] < 0) {
+            file.Error = -fds[i];
+            continue;
+         }
+         file.Created = true;
+         if( (closeResult == -ECANCELED) || (closeResult == NotQueued) ) {
+            // The descriptor has not been closed, so finish synchronously:
+            if( (writeResult < 0) && (writeResult != NotQueued) &&
+                (writeResult != Pending) && (writeResult != -ECANCELED) ) {
+               file.Error = -writeResult;
+            }
+            else {
+               file.Error = writeFileData(fds[i], file,
+                                          (writeResult > 0) ? writeResult : 0);
+            }
+            if( (close(fds[i]) != 0) && (file.Error == 0) ) {
+               file.Error = errno;
+            }
+         }
+         else if(closeResult < 0) {
+            file.Error = (writeResult < 0) ? -writeResult : -closeResult;
+         }
+      }
+
+      // ====== Fall back to the worker threads on failure ==================
+      if(!success) {
+         io_uring_queue_exit(&ring);
+         ringAvailable = false;
+         for(size_t i = chunkStart + chunkFiles; i < files.size(); i++) {
+            remaining.push_back(&files[i]);
+         }
+         break;
+      }
+   }
+
+   runInParallel(remaining.size(), [&](const size_t index) {
+      OutputFile& file = *remaining[index];
+      file.Error   = 0;
+      file.Created = false;
+      writeFile(file);
+   });
+}
+#endif
@@ -0,0 +1,105 @@
+// ==========================================================================
+//                ____  _ _   _____   __  ______
+//                | __ )(_) |_|_   _|__\ \/ / ___|___  _ ____   __
+//                |  _ \| | '_ \| |/ _ \  / |   / _ \| '_ \ \ / /
+//                | |_) | | |_) | |  __//  \ |__| (_) | | | \ V /
+//                |____/|_|_.__/|_|\___/_/\_\____\___/|_| |_|\_/
+//
+//                          ---  BibTeX Converter  ---
+//                   https://www.nntb.no/~dreibh/bibtexconv/
+// ==========================================================================
+//
+// BibTeX Converter
+// Copyright (C) 2010-2026 by Thomas Dreibholz
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Contact: thomas.dreibholz@gmail.com
+
+#ifndef BATCHWRITER_H
+#define BATCHWRITER_H
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+
+// A file to be written by BatchWriter::write()
+struct OutputFile
+{
+   std::string        FileName;
+   const char*        FormatName;   // For error messages, e.g. "BibTeX"
+   const char*        Header;       // Written before the content (or nullptr)
+   const std::string* Content;
+   int                Error;        // Set by BatchWriter::write(): errno or 0
+   bool               Created;      // Set by BatchWriter::write()
+   bool               Changed;      // Set by BatchWriter::write()
+};
+
+
+// Writes many small files in batches. With liburing, the file creations,
+// writes and closes of a batch are submitted through io_uring. Without it,
+// or if io_uring is not usable (e.g. disabled by the kernel or a seccomp
+// filter), the files of a batch are written in parallel by worker threads.
+//
+// With onlyWriteChangedFiles, a file is only written if its content differs
+// from the existing file. The new content is written into a temporary file,
+// which then atomically replaces the old one. Unchanged files are kept
+// untouched, i.e. their timestamps remain the same.
+class BatchWriter
+{
+   public:
+   BatchWriter(const bool onlyWriteChangedFiles = false);
+   ~BatchWriter();
+
+   inline unsigned int getChangedFiles() const {
+      return changedFiles;
+   }
+   inline unsigned int getUnchangedFiles() const {
+      return unchangedFiles;
+   }
+
+   bool write(std::vector<OutputFile>& files);
+
+   // A large file, which is written sequentially (e.g. a combined export):
+   FILE* openCombinedFile(const char*  fileName,
+                          const char*  formatName,
+                          std::string& temporaryFileName);
+   bool closeCombinedFile(FILE*              fh,
+                          const char*        fileName,
+                          const char*        formatName,
+                          const std::string& temporaryFileName);
+
+   private:
+   void writeWithWorkers(std::vector<OutputFile>& files);
+   void writeFile(OutputFile& file);
+#ifdef HAVE_LIBURING
+   void writeWithIOURing(std::vector<OutputFile>& files);
+   bool submitAndWait(const unsigned int prepared, std::vector<int>& results);
+
+   static const unsigned int QueueDepth = 256;
+   struct io_uring           ring;
+   bool                      ringAvailable;
+#endif
+   bool                      onlyChanged;
+   unsigned int              changedFiles;
+   unsigned int              unchangedFiles;
+};
+
+#endif
@@ -27,11 +27,14 @@
 //
 // Contact: thomas.dreibholz@gmail.com
 
+#include "downloadverifier.h"
 #include "mappings.h"
 #include "node.h"
 #include "publicationset.h"
 #include "package-version.h"
 #include "stringhandling.h"
+#include "unification.h"
+#include "urlchecker.h"
 
 #include <getopt.h>
 #include <fcntl.h>
@@ -41,11 +44,6 @@
 #include <string.h>
 #include <assert.h>
 #include <errno.h>
-#include <sys/stat.h>
-#include <sys/types.h>
-#include <curl/curl.h>
-#include <curl/easy.h>
-#include <openssl/evp.h>
 
 
 extern int   yyparse();
@@ -53,442 +51,6 @@ extern FILE* yyin;
 extern Node* bibTeXFile;
 
 
-// ###### Get current timer #################################################
-static unsigned long long getMicroTime()
-{
-  struct timeval tv;
-  gettimeofday(&tv,nullptr);
-  return ((unsigned long long)tv.tv_sec * (unsigned long long)1000000) +
-            (unsigned long long)tv.tv_usec;
-}
-
-
-// ###### Download file via libcurl #########################################
-static bool downloadFile(CURL*         curl,
-                         const char*   url,
-                         FILE*         headerFH,
-                         FILE*         downloadFH,
-                         unsigned int& errors)
-{
-   if( (ftruncate(fileno(headerFH), 0) != 0) ||
-       (ftruncate(fileno(downloadFH), 0) != 0) ) {
-      perror("Unable to truncate output files");
-      return false;
-   }
-
-   curl_easy_setopt(curl, CURLOPT_URL,            url);
-   curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
-   curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 1L);
-   curl_easy_setopt(curl, CURLOPT_WRITEDATA,      downloadFH);
-   curl_easy_setopt(curl, CURLOPT_WRITEHEADER,    headerFH);
-   curl_easy_setopt(curl, CURLOPT_USERAGENT,      "bibtexconv/2.2 (AmigaOS; MC680x0)");
-   curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);   // follow redirects
-   curl_easy_setopt(curl, CURLOPT_AUTOREFERER,    1L);   // set referer on redirect
-   curl_easy_setopt(curl, CURLOPT_COOKIEFILE,     "");   // enable cookies
-   curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 30);   // 30s connect timeout
-
-   bool  resultIsGood    = false;
-   const CURLcode result = curl_easy_perform(curl);
-   if(result == CURLE_OK) {
-      rewind(headerFH);
-      rewind(downloadFH);
-
-      // ====== Check HTTP result =========================
-      if( (strncmp(url, "http", 4)) == 0) {
-         unsigned httpErrorCode = 999;
-         char     header[8192];
-         while(!feof(headerFH)) {
-            // The actual result will be of the last request
-            // in the header file (may have been redirected!)
-            if(!fgets((char*)&header, sizeof(header) - 1, headerFH)) {
-               break;
-            }
-            sscanf(header, "HTTP/%*[^ ] %u ", &httpErrorCode);
-         }
-         if(httpErrorCode == 200) {
-             resultIsGood = true;
-         }
-         if(httpErrorCode != 200) {
-            fprintf(stderr, "FAILED %s - HTTP returns code %u!\n",
-                    url, httpErrorCode);
-
-            /*
-            rewind(headerFH);
-            size_t r = fread((char*)&header, 1, sizeof(header) - 1, headerFH);
-            if(r > 0) {
-               header[r] = 0x00;
-               fputs(header, stderr);
-            }
-            */
-
-            errors++;
-         }
-      }
-   }
-   else {
-      fprintf(stderr, "FAILED %s: %s!\n", url, curl_easy_strerror(result));
-      errors++;
-   }
-
-   return resultIsGood;
-}
-
-
-// ###### Dynamic URL handling ##############################################
-static bool handleDynamicURL(CURL*             curl,
-                             const std::string url,
-                             FILE*             headerFH,
-                             FILE*             downloadFH,
-                             unsigned int&     errors)
-{
-   std::string rest;
-   std::string newURL = "";
-
-   // ====== IEEExplore database ============================================
-   if( (hasPrefix(url, "http://ieeexplore.ieee.org/", rest)) ||
-       (hasPrefix(url, "https://ieeexplore.ieee.org/", rest)) ) {
-      char buffer[65536];
-      size_t r = fread((char*)&buffer, 1, sizeof(buffer) - 1, downloadFH);
-      if((r > 0) && (r < sizeof(buffer) - 1)) {
-         buffer[r] = 0x00;
-
-         fprintf(stderr, "[IEEExplore");
-
-         const std::string inputString(buffer);
-         const size_t      framePos = inputString.rfind("<frame src=\"");
-         // fputs(inputString.c_str(),stderr);
-         if(framePos != std::string::npos) {
-            const size_t a = inputString.find("\"", framePos);
-            const size_t b = inputString.find("\"", a + 1);
-            if( (a != std::string::npos) && (b != std::string::npos) ) {
-               newURL = inputString.substr(a + 1, b - a - 1);
-               fprintf(stderr, "->%s", newURL.c_str());
-            }
-         }
-
-         fprintf(stderr, "] ");
-      }
-   }
-
-   rewind(headerFH);
-   rewind(downloadFH);
-   if(newURL.size() > 0) {
-      // printf("NEW=<%s>\n", newURL.c_str());
-      return downloadFile(curl, newURL.c_str(), headerFH, downloadFH, errors);
-   }
-
-   return true;
-}
-
-
-// ###### Check URLs ########################################################
-static unsigned int checkAllURLs(PublicationSet* publicationSet,
-                                 const char*     downloadDirectory,
-                                 const bool      checkNewURLsOnly,
-                                 const bool      ignoreUpdatesForHTML,
-                                 const bool      quietMode)
-{
-   if(downloadDirectory != nullptr) {
-      if( (mkdir(downloadDirectory, S_IRWXU|S_IXGRP|S_IRGRP|S_IXOTH|S_IROTH) < 0) &&
-          (errno != EEXIST) ) {
-         fprintf(stderr, "ERROR: Failed to create download directory: %s!\n",
-                 strerror(errno));
-         return 1;
-      }
-   }
-
-   CURL* curl = curl_easy_init();
-   if(curl == nullptr) {
-      fputs("ERROR: Failed to initialize libcurl!\n", stderr);
-      return 1;
-   }
-
-   unsigned int errors = 0;
-   for(size_t index = 0; index < publicationSet->size(); index++) {
-      // ====== Get prev, current and next publications =====================
-      if(publicationSet->get(index)->value == "Comment") {
-         continue;
-      }
-      Node* publication = publicationSet->get(index);
-      Node* url         = findChildNode(publication, "url");
-      if(url != nullptr) {
-         const Node* urlSize    = findChildNode(publication, "url.size");
-         const Node* urlMime    = findChildNode(publication, "url.mime");
-         const Node* urlChecked = findChildNode(publication, "url.checked");
-         if( (urlSize != nullptr) && (urlMime != nullptr) && (urlChecked != nullptr) ) {
-            if(downloadDirectory != nullptr) {
-               const std::string downloadFileName =
-                  PublicationSet::makeDownloadFileName(downloadDirectory,
-                                                       publication->keyword,
-                                                       urlMime->value);
-               FILE* downloadFH = fopen(downloadFileName.c_str(), "rb");
-               if(downloadFH != nullptr) {
-                  fclose(downloadFH);
-                  if(!quietMode) {
-                     fprintf(stderr, "Skipping URL of %s (already available as %s).\n",
-                           publication->keyword.c_str(),
-                           downloadFileName.c_str());
-                  }
-                  continue;
-               }
-            }
-            else if(checkNewURLsOnly == true) {
-               if(!quietMode) {
-                  fprintf(stderr, "Skipping URL of %s (not a new entry).\n", publication->keyword.c_str());
-               }
-               continue;
-            }
-         }
-
-         fprintf(stderr, "Checking URL of %s ... ", publication->keyword.c_str());
-
-         char downloadFileName[256];
-         char mimeFileName[256];
-         char metaFileName[256];
-         if(downloadDirectory != nullptr) {
-            snprintf((char*)&downloadFileName, sizeof(downloadFileName), "%s/%s", downloadDirectory, "/bibtexconv-dXXXXXX");
-         }
-         else {
-            snprintf((char*)&downloadFileName, sizeof(downloadFileName), "%s", "/tmp/bibtexconv-dXXXXXX");
-         }
-         snprintf((char*)&mimeFileName, sizeof(mimeFileName), "%s",      "/tmp/bibtexconv-mXXXXXX");
-         snprintf((char*)&metaFileName, sizeof(metaFileName), "%s",      "/tmp/bibtexconv-pXXXXXX");
-
-         const int dfd = mkstemp((char*)&downloadFileName);
-         const int mfd = mkstemp((char*)&mimeFileName);
-         if( (dfd > 0) && (mfd > 0) ) {
-            FILE* downloadFH = fopen(downloadFileName, "w+b");
-            if(downloadFH != nullptr) {
-               FILE* headerFH = tmpfile();
-               if(headerFH != nullptr) {
-                  bool resultIsGood = downloadFile(curl, url->value.c_str(), headerFH, downloadFH, errors);
-                  if(resultIsGood) {
-                     // Special handling for dynamic URLs of some publishers
-                     resultIsGood = handleDynamicURL(curl, url->value, headerFH, downloadFH, errors);
-                  }
-                  if(resultIsGood) {
-                     unsigned long long totalSize = 0;
-
-                     unsigned int  md5Length = EVP_MD_size(EVP_md5());
-                     unsigned char md5[EVP_MD_size(EVP_md5())];
-                     EVP_MD_CTX*   md5Context = EVP_MD_CTX_new();
-                     EVP_DigestInit_ex(md5Context, EVP_md5(), nullptr);
-
-                     // ====== Compute size and MD5 =========================
-                     while(!feof(downloadFH)) {
-                        char input[16384];
-                        const size_t bytesRead = fread(&input, 1, sizeof(input), downloadFH);
-                        if(bytesRead > 0) {
-                           totalSize += (unsigned long long)bytesRead;
-                           EVP_DigestUpdate(md5Context, &input, bytesRead);
-                        }
-                     }
-
-                     if(totalSize > 0) {
-                        // ====== Compute mime type (using "file") =======
-                        std::string mimeString;
-#if !defined(__sun__)
-                        std::string command = format("file --mime-type -b %s >%s", downloadFileName, mimeFileName);
-#else
-                        // Solaris needs the GNU file command:
-                        std::string command = format("/usr/gnu/bin/file --mime-type -b %s >%s", downloadFileName, mimeFileName);
-#endif
-                        if(system(command.c_str()) == 0) {
-                           FILE* mimeFH = fopen(mimeFileName, "r");
-                           if(mimeFH != nullptr) {
-                              char input[1024];
-                              if(fgets((char*)&input, sizeof(input) - 1, mimeFH) != nullptr) {
-                                 mimeString = std::string(input);
-                                 if( (mimeString.size() > 0) &&
-                                     (mimeString[mimeString.size() - 1] == '\n') ) {
-                                    mimeString = mimeString.substr(0, mimeString.size() - 1);
-                                 }
-
-                                 // RFCs/I-Ds are sometimes misidentified as source code:
-                                 if( (mimeString == "text/x-pascal") ||
-                                     (mimeString == "text/x-c") ||
-                                     (mimeString == "text/x-c++") ) {
-                                    mimeString = "text/plain";
-                                 }
-                              }
-                              fclose(mimeFH);
-                           }
-                        }
-                        else {
-                           fprintf(stderr, "WARNING %s: failed to obtain mime type of download file!\n",
-                                   url->value.c_str());
-                        }
-
-                        // ====== Compare size, mime type and MD5 ===========
-                        std::string sizeString = format("%llu", totalSize);
-                        std::string md5String;
-                        EVP_DigestFinal_ex(md5Context, (unsigned char*)&md5, &md5Length);
-                        for(unsigned int i = 0; i < md5Length; i++) {
-                           md5String += format("%02x", (unsigned int)md5[i]);
-                        }
-                        const Node* urlMimeNode = findChildNode(publication, "url.mime");
-                        const Node* urlSizeNode = findChildNode(publication, "url.size");
-                        const Node* urlMD5Node  = findChildNode(publication, "url.md5");
-
-                        bool failed = false;
-                        if((urlMimeNode != nullptr) && (urlMimeNode->value != mimeString)) {
-                           if( (urlMimeNode->value == "text/html") &&
-                               (mimeString == "application/pdf") ) {
-                              fprintf(stderr, "\nNOTE: change from HTML to PDF -> just updating entry\n");
-                              urlSizeNode = nullptr;
-                              urlMD5Node  = nullptr;
-                           }
-                           else {
-                              fprintf(stderr, "UPDATED %s: old mime type has been %s, new type mime is %s\n",
-                                      url->value.c_str(),
-                                      urlMimeNode->value.c_str(), mimeString.c_str());
-                           }
-                        }
-                        if( (!failed) && (urlSizeNode != nullptr) && (urlSizeNode->value != sizeString) ) {
-                            if( (ignoreUpdatesForHTML == true) &&
-                                ((urlMimeNode != nullptr) &&
-                                 ((urlMimeNode->value == "text/html") ||
-                                  (urlMimeNode->value == "application/xml"))) ) {
-                               md5String = "ignore";
-                               fprintf(stderr, "[Size change for HTML/XML document -> setting url.md5=\"ignore\"] ");
-                            }
-                            else {
-                              fprintf(stderr, "UPDATED %s: old size has been %s, new size is %s\n",
-                                      url->value.c_str(),
-                                      urlSizeNode->value.c_str(), sizeString.c_str());
-                            }
-                        }
-                        if( (!failed) && (urlMD5Node != nullptr) && (urlMD5Node->value != "ignore") &&
-                           (urlMD5Node->value != md5String)) {
-                            if( (ignoreUpdatesForHTML == true) &&
-                                ((urlMimeNode != nullptr) &&
-                                 ((urlMimeNode->value == "text/html") ||
-                                  (urlMimeNode->value == "application/xml"))) ) {
-                               md5String = "ignore";
-                               fprintf(stderr, "[MD5 change for HTML/XML document -> setting url.md5=\"ignore\"] ");
-                            }
-                            else {
-                               fprintf(stderr, "UPDATED %s: old MD5 has been %s, new MD5 is %s\n",
-                                       url->value.c_str(),
-                                       urlMD5Node->value.c_str(), md5String.c_str());
-                            }
-                        }
-
-                        // ====== Check PDF metadata ========================
-                        if(mimeString == "application/pdf") {
-                           std::string command = format("pdfinfo %s >%s", downloadFileName, metaFileName);
-                           if(system(command.c_str()) == 0) {
-                              FILE* metaFH = fopen(metaFileName, "r");
-                              if(metaFH != nullptr) {
-                                 while(!feof(metaFH)) {
-                                    char input[1024];
-                                    if(fgets((char*)&input, sizeof(input) - 1, metaFH) != nullptr) {
-                                       // printf("IN=%s",input);
-                                       if(strncmp(input, "Pages:", 6) == 0) {
-                                          addOrUpdateChildNode(publication, "numpages", format("%u", atol((const char*)&input[6])).c_str());
-                                       }
-                                       else if(strncmp(input, "Keywords:", 9) == 0) {
-                                          Node* keywords = findChildNode(publication, "keywords");
-                                          if(keywords == nullptr) {
-                                             // If there are no "keywords", add "url.keywords".
-                                             // They can be renamed manually after a check.
-                                             std::string keywords((const char*)&input[9]);
-                                             addOrUpdateChildNode(publication, "url.keywords",
-                                                                  string2utf8(trim(keywords), "~", "").c_str());
-                                          }
-                                       }
-                                       else if(strncmp(input, "Page size:", 10) == 0) {
-                                          std::string pagesize((const char*)&input[10]);
-                                          addOrUpdateChildNode(publication, "url.pagesize",
-                                                               string2utf8(trim(pagesize), "~", "").c_str());
-                                       }
-                                    }
-                                 }
-                                 fclose(metaFH);
-                              }
-                           }
-
-                        }
-
-                        // ====== Update metadata ===========================
-                        if(!failed) {
-                           // ====== Update size, mime type and MD5 =========
-                           addOrUpdateChildNode(publication, "url.size", sizeString.c_str());
-                           addOrUpdateChildNode(publication, "url.mime", mimeString.c_str());
-                           if( (urlMD5Node == nullptr) || (urlMD5Node->value != "ignore")) {
-                              addOrUpdateChildNode(publication, "url.md5",  md5String.c_str());
-                           }
-
-                           // ====== Update check time ======================
-                           const unsigned long long microTime = getMicroTime();
-                           const time_t             timeStamp = microTime / 1000000;
-                           const tm*                timeptr   = localtime(&timeStamp);
-                           char  checkTime[128];
-                           strftime((char*)&checkTime, sizeof(checkTime), "%Y-%m-%d %H:%M:%S %Z", timeptr);
-                           addOrUpdateChildNode(publication, "url.checked", checkTime);
-
-                           fprintf(stderr, "OK: size=%sB;\ttype=%s;\tMD5=%s\n",
-                                   sizeString.c_str(), mimeString.c_str(), md5String.c_str());
-
-                           // ====== Move downloaded file ===================
-                           if(downloadDirectory != nullptr) {
-                              fclose(downloadFH);
-                              downloadFH = nullptr;
-                              const std::string newFileName =
-                                 PublicationSet::makeDownloadFileName(downloadDirectory, publication->keyword, mimeString);
-                              if(rename(downloadFileName, newFileName.c_str()) < 0) {
-                                 unlink(downloadFileName);
-                                 fprintf(stderr, "\nFAILED to store download file %s: %s!\n",
-                                         newFileName.c_str(), strerror(errno));
-                                 errors++;
-                              }
-                           }
-                        }
-                     }
-                     else {
-                        fprintf(stderr, "\nFAILED %s: size is zero!\n", url->value.c_str());
-                        errors++;
-                     }
-                  }
-                  fclose(headerFH);
-                  headerFH = nullptr;
-               }
-               else {
-                  fputs("ERROR: Failed to create temporary header file!\n", stderr);
-                  errors++;
-               }
-               if(downloadFH != nullptr) {
-                  fclose(downloadFH);
-                  downloadFH = nullptr;
-                  unlink(downloadFileName);
-               }
-               unlink(mimeFileName);
-            }
-            else {
-               fputs("ERROR: Failed to create temporary download file!\n", stderr);
-               errors++;
-            }
-         }
-         else {
-            fputs("ERROR: Failed to create temporary file name!\n", stderr);
-            errors++;
-         }
-         if(dfd >= 0) {
-            close(dfd);
-         }
-         if(mfd >= 0) {
-            close(mfd);
-         }
-      }
-   }
-
-   curl_easy_cleanup(curl);
-   curl = nullptr;
-
-   return errors;
-}
-
-
 // ###### Handle interactive input ##########################################
 static bool                     useXMLStyle            = false;
 static std::string              nbsp                   = " ";
@@ -499,22 +61,15 @@ static std::string              customPrintingTemplate =
    "\\[%{anchor}\\] %{label}\n%{begin-author-loop}AUTHOR: [[%{is-first-author?}FIRST|%{is-last-author?}LAST|%{is-not-first-author?}NOT-FIRST]: initials=%{author-initials} given=%{author-given-name} family=%{author-family-name}]\n%{end-author-loop}\n\"%{title}\"[, %{booktitle}][, %{journal}][, %{institution}][, %{publisher}][, Volume~%{volume}][, Number~%{number}][, pp.~%{pages}][, %{isbn}][, %{issn}][, %{address}][, [[%{month-number}, %{day}, |%{month-number}~]%{year}].\\nURL: %{url}.\\n\\n";
 static std::vector<std::string> monthNames;
 
-static int handleInput(FILE*           fh,
-                       PublicationSet& publicationSet,
-                       const char*     downloadDirectory,
-                       const Mappings& mappings,
-                       const bool      checkURLs,
-                       const bool      checkNewURLsOnly,
-                       const bool      ignoreUpdatesForHTML,
-                       const char*     exportToBibTeX,
-                       const char*     exportToSeparateBibTeXs,
-                       const char*     exportToXML,
-                       const char*     exportToSeparateXMLs,
-                       const bool      skipNotesWithISBNandISSN,
-                       const bool      addNotesWithISBNandISSN,
-                       const bool      addUrlCommand,
-                       const bool      quietMode,
-                       unsigned int    recursionLevel = 0)
+static int handleInput(FILE*              fh,
+                       PublicationSet&    publicationSet,
+                       const char*        downloadDirectory,
+                       const Mappings&    mappings,
+                       const bool         checkURLs,
+                       URLChecker&        urlChecker,
+                       const bool         verifyStoredDownloads,
+                       const ExportSinks& exportSinks,
+                       unsigned int       recursionLevel = 0)
 {
    int result = 0;
    while(!feof(fh)) {
@@ -601,9 +156,26 @@ static int handleInput(FILE*           fh,
                                 (const bool*)&sortAscending,
                                 sortLevels);
          }
+         else if((strncmp(input, "checkURLs", 9)) == 0) {
+            result += urlChecker.checkAll(&publicationSet);
+         }
+         else if((strncmp(input, "verifyDownloads", 15)) == 0) {
+            if(downloadDirectory != nullptr) {
+               result += verifyDownloads(&publicationSet, downloadDirectory,
+                                         stderr, exportSinks.quietMode);
+            }
+            else {
+               fputs("ERROR: verifyDownloads needs a download directory (--store-downloads)!\n", stderr);
+               result++;
+            }
+         }
          else if((strncmp(input, "export", 5)) == 0) {
             if(checkURLs) {
-               result += checkAllURLs(&publicationSet, downloadDirectory, checkNewURLsOnly, ignoreUpdatesForHTML, quietMode);
+               result += urlChecker.checkAll(&publicationSet);
+            }
+            if(verifyStoredDownloads) {
+               result += verifyDownloads(&publicationSet, downloadDirectory,
+                                         stderr, exportSinks.quietMode);
             }
             const char* namingTemplate = "%u";
             if(input[6] == ' ') {
@@ -619,34 +191,9 @@ static int handleInput(FILE*           fh,
                result++;
             }
 
-            // ====== Export all to BibTeX ==================================
-            if(exportToBibTeX) {
-               if(PublicationSet::exportPublicationSetToBibTeX(
-                  &publicationSet, exportToBibTeX, false,
-                  skipNotesWithISBNandISSN, addNotesWithISBNandISSN, addUrlCommand) == false) {
-                  return 1;
-               }
-            }
-            if(exportToSeparateBibTeXs) {
-               if(PublicationSet::exportPublicationSetToBibTeX(
-                  &publicationSet, exportToSeparateBibTeXs, true,
-                  skipNotesWithISBNandISSN, addNotesWithISBNandISSN, addUrlCommand) == false) {
-                  return 1;
-               }
-            }
-
-            // ====== Export all to XML =====================================
-            if(exportToXML) {
-               if(PublicationSet::exportPublicationSetToXML(
-                  &publicationSet, exportToXML, false) == false) {
-                  return 1;
-               }
-            }
-            if(exportToSeparateXMLs) {
-               if(PublicationSet::exportPublicationSetToXML(
-                  &publicationSet, exportToSeparateXMLs, true) == false) {
-                  return 1;
-               }
+            // ====== Export all to BibTeX, XML and JSON ====================
+            if(PublicationSet::exportPublicationSet(&publicationSet, exportSinks) == false) {
+               return 1;
             }
          }
          else if((strncmp(input, "clear", 5)) == 0) {
@@ -689,12 +236,9 @@ static int handleInput(FILE*           fh,
                if(includeFH != nullptr) {
                   result += handleInput(includeFH, publicationSet,
                                         downloadDirectory, mappings,
-                                        checkURLs, checkNewURLsOnly, ignoreUpdatesForHTML,
-                                        exportToBibTeX, exportToSeparateBibTeXs,
-                                        exportToXML, exportToSeparateXMLs,
-                                        skipNotesWithISBNandISSN, addNotesWithISBNandISSN,
-                                        addUrlCommand, quietMode,
-                                        recursionLevel + 1);
+                                        checkURLs, urlChecker,
+                                        verifyStoredDownloads,
+                                        exportSinks, recursionLevel + 1);
                   fclose(includeFH);
                }
                else {
@@ -746,18 +290,35 @@ static int handleInput(FILE*           fh,
       "[-b xml_file_prefix| --export-to-separate-bibtexs xml_file_prefix]"
       "[-X xml_file_name | --export-to-xml xml_file_name]"
       "[-x xml_file_prefix | --export-to-separate-xmls xml_file_prefix]"
+      "[-J json_file_name | --export-to-json json_file_name]"
       "[-C custom_file | --export-to-custom custom_file]"
+      "[-W | --only-write-changed-files]"
       "[-D directory | --store-downloads directory]"
+      "[-O | --content-addressed-store]"
+      "[-V | --verify-downloads]"
       "[-m name:mapping_file:key_column:value_column | --mapping name:mapping_file:key_column:value_column]"
+      "[-M mapping_file:key_column | --compile-mapping mapping_file:key_column]"
       "[-s string | --nbsp string]"
       "[-l string | --linebreak string]"
       "[-n | --non-interactive]"
       "[-U | --check-urls]"
       "[-u | --only-check-new-urls]"
       "[-w | --ignore-updates-for-html]"
+      "[-P transfers | --url-parallelism transfers]"
+      "[-H transfers | --url-host-parallelism transfers]"
+      "[-d milliseconds | --url-host-delay milliseconds]"
+      "[-r retries | --url-retries retries]"
+      "[-E | --url-head-probe]"
+      "[-S bytes | --url-buffer-size bytes]"
+      "[-T report_file | --url-timings report_file]"
+      "[-c cache_file | --url-cache cache_file]"
+      "[-R duration | --recheck-after duration]"
       "[-a | --add-url-command]"
       "[-i | --skip-notes-with-isbn-and-issn]"
       "[-I | --add-notes-with-isbn-and-issn]"
+      "[-z | --lazy-unification]"
+      "[-L | --lint]"
+      "[-q | --quiet]"
       "[-h | --help]"
       "[-v | --version]"
       "\n", program);
@@ -776,14 +337,32 @@ int main(int argc, char** argv)
    bool        skipNotesWithISBNandISSN = false;
    bool        addNotesWithISBNandISSN  = false;
    bool        addUrlCommand            = false;
+   bool        onlyWriteChangedFiles    = false;
    bool        quietMode                = false;
+   bool        lazyUnification          = false;
+   bool        lintMode                 = false;
    const char* exportToBibTeX           = nullptr;
    const char* exportToSeparateBibTeXs  = nullptr;
    const char* exportToXML              = nullptr;
    const char* exportToSeparateXMLs     = nullptr;
+   const char* exportToJSON             = nullptr;
    const char* exportToCustom           = nullptr;
    const char* downloadDirectory        = nullptr;
+   bool        contentAddressedStore    = false;
+   bool        verifyStoredDownloads    = false;
    Mappings    mappings;
+   unsigned int compiledMappings   = 0;
+   unsigned int urlParallelism     = 1;
+   unsigned int urlHostParallelism = 1;
+   unsigned int urlHostDelay       = 0;
+   unsigned int urlRetries         = 2;
+   bool         urlHeadProbe       = false;
+   size_t       urlBufferSize      = 16 * 1048576;
+   const char*  urlTimingReport    = nullptr;
+   const char*  urlCacheFile       = nullptr;
+   unsigned int recheckAfter       = 0;
+   URLCache     urlCache;
+   URLChecker   urlChecker;
 
    monthNames.push_back("January");
    monthNames.push_back("February");
@@ -803,9 +382,14 @@ int main(int argc, char** argv)
       { "export-to-separate-bibtexs",    required_argument, 0, 'b' },
       { "export-to-xml",                 required_argument, 0, 'X' },
       { "export-to-separate-xmls",       required_argument, 0, 'x' },
+      { "export-to-json",                required_argument, 0, 'J' },
       { "export-to-custom",              required_argument, 0, 'C' },
+      { "only-write-changed-files",      no_argument,       0, 'W' },
       { "store-downloads",               required_argument, 0, 'D' },
+      { "content-addressed-store",       no_argument,       0, 'O' },
+      { "verify-downloads",              no_argument,       0, 'V' },
       { "mapping",                       required_argument, 0, 'm' },
+      { "compile-mapping",               required_argument, 0, 'M' },
 
       { "nbsp",                          required_argument, 0, 's' },
       { "linebreak",                     required_argument, 0, 'l' },
@@ -813,9 +397,20 @@ int main(int argc, char** argv)
       { "check-urls",                    no_argument,       0, 'U' },
       { "only-check-new-urls",           no_argument,       0, 'u' },
       { "ignore-updates-for-html",       no_argument,       0, 'w' },
+      { "url-parallelism",               required_argument, 0, 'P' },
+      { "url-host-parallelism",          required_argument, 0, 'H' },
+      { "url-host-delay",                required_argument, 0, 'd' },
+      { "url-retries",                   required_argument, 0, 'r' },
+      { "url-head-probe",                no_argument,       0, 'E' },
+      { "url-buffer-size",               required_argument, 0, 'S' },
+      { "url-timings",                   required_argument, 0, 'T' },
+      { "url-cache",                     required_argument, 0, 'c' },
+      { "recheck-after",                 required_argument, 0, 'R' },
       { "add-url-command",               no_argument,       0, 'a' },
       { "skip-notes-with-isbn-and-issn", no_argument,       0, 'i' },
       { "add-notes-with-isbn-and-issn",  no_argument,       0, 'I' },
+      { "lazy-unification",              no_argument,       0, 'z' },
+      { "lint",                          no_argument,       0, 'L' },
       { "quiet",                         no_argument,       0, 'q' },
 
       { "help",                          no_argument,       0, 'h' },
@@ -825,7 +420,7 @@ int main(int argc, char** argv)
 
    int option;
    int longIndex;
-   while( (option = getopt_long(argc, argv, "B:b:X:x:C:D:m:s:l:nUuwaiIqhv", long_options, &longIndex)) != -1 ) {
+   while( (option = getopt_long(argc, argv, "B:b:X:x:J:C:WD:OVm:M:s:l:nUuwP:H:d:r:ES:T:c:R:aiIzLqhv", long_options, &longIndex)) != -1 ) {
       switch(option) {
          case 'B':
             exportToBibTeX = optarg;
@@ -839,20 +434,49 @@ int main(int argc, char** argv)
          case 'x':
             exportToSeparateXMLs = optarg;
           break;
+         case 'J':
+            exportToJSON = optarg;
+          break;
          case 'C':
             exportToCustom = optarg;
           break;
+         case 'W':
+            onlyWriteChangedFiles = true;
+          break;
          case 'D':
             downloadDirectory = optarg;
           break;
+         case 'O':
+            contentAddressedStore = true;
+          break;
+         case 'V':
+            verifyStoredDownloads = true;
+          break;
          case 'm': {
             std::vector<std::string> mappingArguments;
             splitString(mappingArguments, std::string(optarg));
             if(mappingArguments.size() == 4) {
-               if(!mappings.addMapping(mappingArguments[0], mappingArguments[1],
-                                       mappingArguments[2], mappingArguments[3])) {
+               // Several value columns may be given, separated by ",". They
+               // get mapping names "name.value_column", unless the same
+               // number of names is given, separated by "," as well.
+               std::vector<std::string> mappingNames;
+               std::vector<std::string> valueColumns;
+               splitString(mappingNames, mappingArguments[0], ",");
+               splitString(valueColumns, mappingArguments[3], ",");
+               if( (mappingNames.size() != 1) &&
+                   (mappingNames.size() != valueColumns.size()) ) {
+                  fprintf(stderr, "ERROR: Bad mapping specification %s!\n", optarg);
                   exit(1);
                }
+               for(size_t i = 0; i < valueColumns.size(); i++) {
+                  const std::string mappingName =
+                     (mappingNames.size() == valueColumns.size()) ?
+                        mappingNames[i] : mappingNames[0] + "." + valueColumns[i];
+                  if(!mappings.addMapping(mappingName, mappingArguments[1],
+                                          mappingArguments[2], valueColumns[i])) {
+                     exit(1);
+                  }
+               }
             }
             else {
                fprintf(stderr, "ERROR: Bad mapping specification %s!\n", optarg);
@@ -860,6 +484,21 @@ int main(int argc, char** argv)
             }
           }
           break;
+         case 'M': {
+            std::vector<std::string> compileArguments;
+            splitString(compileArguments, std::string(optarg));
+            if(compileArguments.size() == 2) {
+               if(!mappings.compileMapping(compileArguments[0], compileArguments[1])) {
+                  exit(1);
+               }
+               compiledMappings++;
+            }
+            else {
+               fprintf(stderr, "ERROR: Bad mapping compilation specification %s!\n", optarg);
+               exit(1);
+            }
+          }
+          break;
          case 's':
             nbsp = optarg;
           break;
@@ -878,6 +517,42 @@ int main(int argc, char** argv)
          case 'w':
             ignoreUpdatesForHTML = true;
           break;
+         case 'P':
+            urlParallelism = atol(optarg);
+            if(urlParallelism < 1) {
+               urlParallelism = 1;
+            }
+          break;
+         case 'H':
+            urlHostParallelism = atol(optarg);
+            if(urlHostParallelism < 1) {
+               urlHostParallelism = 1;
+            }
+          break;
+         case 'd':
+            urlHostDelay = atol(optarg);
+          break;
+         case 'r':
+            urlRetries = atol(optarg);
+          break;
+         case 'E':
+            urlHeadProbe = true;
+          break;
+         case 'S':
+            urlBufferSize = atoll(optarg);
+          break;
+         case 'T':
+            urlTimingReport = optarg;
+          break;
+         case 'c':
+            urlCacheFile = optarg;
+          break;
+         case 'R':
+            if(!parseDuration(optarg, recheckAfter)) {
+               fprintf(stderr, "ERROR: Bad duration %s!\n", optarg);
+               exit(1);
+            }
+          break;
          case 'a':
             addUrlCommand = true;
           break;
@@ -888,6 +563,12 @@ int main(int argc, char** argv)
             skipNotesWithISBNandISSN = true;   // Drop old ones, if there are any
             addNotesWithISBNandISSN  = true;   // Compute new ones
           break;
+         case 'z':
+            lazyUnification = true;
+          break;
+         case 'L':
+            lintMode = true;
+          break;
          case 'q':
             quietMode = true;
           break;
@@ -910,7 +591,58 @@ int main(int argc, char** argv)
       }
    }
 
-   int result = 0;
+   if(lintMode) {
+      lazyUnification = false;   // Lint needs all entries to be checked!
+   }
+   if( (compiledMappings > 0) && (optind >= argc) ) {
+      return 0;   // Just compiled mappings, nothing else to do.
+   }
+   if( (contentAddressedStore) && (downloadDirectory == nullptr) ) {
+      fputs("ERROR: --content-addressed-store needs a download directory (--store-downloads)!\n", stderr);
+      exit(1);
+   }
+   if( (verifyStoredDownloads) && (downloadDirectory == nullptr) ) {
+      fputs("ERROR: --verify-downloads needs a download directory (--store-downloads)!\n", stderr);
+      exit(1);
+   }
+   urlChecker.setDownloadDirectory(downloadDirectory);
+   urlChecker.setContentAddressedStore(contentAddressedStore);
+   urlChecker.setCheckNewURLsOnly(checkNewURLsOnly);
+   urlChecker.setIgnoreUpdatesForHTML(ignoreUpdatesForHTML);
+   urlChecker.setQuietMode(quietMode);
+   urlChecker.setParallelism(urlParallelism);
+   urlChecker.setHostParallelism(urlHostParallelism);
+   urlChecker.setHostDelay(urlHostDelay);
+   urlChecker.setRetries(urlRetries);
+   urlChecker.setHeadProbe(urlHeadProbe);
+   urlChecker.setBufferSize(urlBufferSize);
+   urlChecker.setTimingReport(urlTimingReport);
+   if(urlCacheFile != nullptr) {
+      if(!urlCache.load(urlCacheFile)) {
+         exit(1);
+      }
+      urlChecker.setCache(&urlCache);
+   }
+   else if(recheckAfter > 0) {
+      fputs("ERROR: --recheck-after needs a URL cache (--url-cache)!\n", stderr);
+      exit(1);
+   }
+   urlChecker.setRecheckAfter(recheckAfter);
+
+   ExportSinks exportSinks;
+   exportSinks.bibTeXFile               = exportToBibTeX;
+   exportSinks.separateBibTeXsPrefix    = exportToSeparateBibTeXs;
+   exportSinks.xmlFile                  = exportToXML;
+   exportSinks.separateXMLsPrefix       = exportToSeparateXMLs;
+   exportSinks.jsonFile                 = exportToJSON;
+   exportSinks.skipNotesWithISBNandISSN = skipNotesWithISBNandISSN;
+   exportSinks.addNotesWithISBNandISSN  = addNotesWithISBNandISSN;
+   exportSinks.addUrlCommand            = addUrlCommand;
+   exportSinks.onlyWriteChangedFiles    = onlyWriteChangedFiles;
+   exportSinks.quietMode                = quietMode;
+
+   int    result              = 0;
+   size_t entriesWithWarnings = 0;
    if(optind < argc) {
       do {
          yyin = fopen(argv[optind], "r");
@@ -923,6 +655,9 @@ int main(int argc, char** argv)
          if(result != 0) {
             break;
          }
+         if(!lazyUnification) {
+            entriesWithWarnings += unifyPublications(bibTeXFile);
+         }
          optind++;
       } while(optind < argc);
    }
@@ -931,42 +666,29 @@ int main(int argc, char** argv)
       exit(1);
    }
 
-   if(result == 0) {
+   if( (result == 0) && (lintMode) ) {
+      // ====== Lint: just report the entries having warnings ===============
+      if((!quietMode) || (entriesWithWarnings > 0)) {
+         fprintf(stderr, "Lint: %u entries with warnings.\n",
+                 (unsigned int)entriesWithWarnings);
+      }
+      result = (entriesWithWarnings > 0) ? 1 : 0;
+   }
+   else if(result == 0) {
       PublicationSet publicationSet(countNodes(bibTeXFile));
       if(!interactive) {
          publicationSet.addAll(bibTeXFile);
          if(checkURLs) {
-            result += checkAllURLs(&publicationSet, downloadDirectory, checkNewURLsOnly, ignoreUpdatesForHTML, quietMode);
-         }
-
-         // ====== Export all to BibTeX =====================================
-         if(exportToBibTeX) {
-            if(PublicationSet::exportPublicationSetToBibTeX(
-               &publicationSet, exportToBibTeX, false,
-               skipNotesWithISBNandISSN, addNotesWithISBNandISSN, addUrlCommand) == false) {
-               result = 1;
-            }
+            result += urlChecker.checkAll(&publicationSet);
          }
-         if(exportToSeparateBibTeXs) {
-            if(PublicationSet::exportPublicationSetToBibTeX(
-               &publicationSet, exportToSeparateBibTeXs, true,
-               skipNotesWithISBNandISSN, addNotesWithISBNandISSN, addUrlCommand) == false) {
-               result = 1;
-            }
+         if(verifyStoredDownloads) {
+            result += verifyDownloads(&publicationSet, downloadDirectory, stderr, quietMode);
          }
 
-         // ====== Export all to XML ========================================
-         if(exportToXML) {
-            if(PublicationSet::exportPublicationSetToXML(
-               &publicationSet, exportToXML, false) == false) {
-               result = 1;
-            }
-         }
-         if(exportToSeparateXMLs) {
-            if(PublicationSet::exportPublicationSetToXML(
-               &publicationSet, exportToSeparateXMLs, true) == false) {
-               result = 1;
-            }
+         // ====== Export all to BibTeX, XML and JSON =======================
+         // All BibTeX, XML and JSON outputs are made in one traversal.
+         if(PublicationSet::exportPublicationSet(&publicationSet, exportSinks) == false) {
+            result = 1;
          }
 
          // ====== Export all to custom format ==============================
@@ -988,11 +710,9 @@ int main(int argc, char** argv)
          }
          result = handleInput(stdin, publicationSet,
                               downloadDirectory, mappings,
-                              checkURLs, checkNewURLsOnly, ignoreUpdatesForHTML,
-                              exportToBibTeX, exportToSeparateBibTeXs,
-                              exportToXML, exportToSeparateXMLs,
-                              skipNotesWithISBNandISSN, addNotesWithISBNandISSN,
-                              addUrlCommand, quietMode);
+                              checkURLs, urlChecker,
+                              verifyStoredDownloads,
+                              exportSinks);
          if((!quietMode) || (result > 0)) {
             fprintf(stderr, "Done. %u errors have occurred.\n", result);
          }
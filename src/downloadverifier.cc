@@ -0,0 +1,256 @@
+// ==========================================================================
+//                ____  _ _   _____   __  ______
+//                | __ )(_) |_|_   _|__\ \/ / ___|___  _ ____   __
+//                |  _ \| | '_ \| |/ _ \  / |   / _ \| '_ \ \ / /
+//                | |_) | | |_) | |  __//  \ |__| (_) | | | \ V /
+//                |____/|_|_.__/|_|\___/_/\_\____\___/|_| |_|\_/
+//
+//                          ---  BibTeX Converter  ---
+//                   https://www.nntb.no/~dreibh/bibtexconv/
+// ==========================================================================
+//
+// BibTeX Converter
+// Copyright (C) 2010-2026 by Thomas Dreibholz
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Contact: thomas.dreibholz@gmail.com
+
+#include "downloadverifier.h"
+#include "node.h"
+#include "stringhandling.h"
+#include "workerpool.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <openssl/evp.h>
+
+#include <string>
+#include <vector>
+
+
+enum DownloadStatus {
+   DownloadOK           = 0,
+   DownloadMissing      = 1,
+   DownloadSizeMismatch = 2,
+   DownloadCorrupt      = 3,
+   DownloadUnreadable   = 4
+};
+static const char* DownloadStatusNames[] = {
+   "OK", "MISSING", "SIZE-MISMATCH", "CORRUPT", "UNREADABLE"
+};
+
+struct DownloadVerification {
+   Node*              Publication;
+   std::string        FileName;
+   std::string        ExpectedSize;           // Empty, if unknown
+   std::string        ExpectedMD5;            // Empty, if unknown or "ignore"
+   DownloadStatus     Status;
+   unsigned long long Size;
+   std::string        MD5;
+   int                Error;                  // errno value, if unreadable
+};
+
+
+// ###### Compute MD5 of a file ############################################
+// The file is mapped. If this is not possible (e.g. on a filesystem not
+// supporting mmap()), it is read instead. Returns 0 or an errno value.
+static int computeMD5(const int fd, const size_t length, std::string& md5String)
+{
+   EVP_MD_CTX* context = EVP_MD_CTX_new();
+   if(context == nullptr) {
+      return ENOMEM;
+   }
+   int error = (EVP_DigestInit_ex(context, EVP_md5(), nullptr) == 1) ? 0 : EIO;
+
+   // ====== Hash mapped file ===============================================
+   void* data = (length > 0) ?
+                   mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+   if(data != MAP_FAILED) {
+      madvise(data, length, MADV_SEQUENTIAL);
+      if( (error == 0) && (EVP_DigestUpdate(context, data, length) != 1) ) {
+         error = EIO;
+      }
+      munmap(data, length);
+   }
+
+   // ====== Hash file by reading it ========================================
+   else {
+      char buffer[65536];
+      while(error == 0) {
+         const ssize_t bytes = read(fd, buffer, sizeof(buffer));
+         if(bytes < 0) {
+            if(errno != EINTR) {
+               error = errno;
+            }
+         }
+         else if(bytes == 0) {
+            break;
+         }
+         else if(EVP_DigestUpdate(context, buffer, bytes) != 1) {
+            error = EIO;
+         }
+      }
+   }
+
+   // ====== Get the result =================================================
+   unsigned char md5[EVP_MAX_MD_SIZE];
+   unsigned int  md5Length = 0;
+   if( (error == 0) &&
+       (EVP_DigestFinal_ex(context, (unsigned char*)&md5, &md5Length) == 1) ) {
+      md5String.clear();
+      for(unsigned int i = 0; i < md5Length; i++) {
+         md5String += format("%02x", (unsigned int)md5[i]);
+      }
+   }
+   else if(error == 0) {
+      error = EIO;
+   }
+   EVP_MD_CTX_free(context);
+   return error;
+}
+
+
+// ###### Verify a single download ##########################################
+// NOTE: This runs in a worker thread. It must not modify the publication!
+static void verifyDownload(DownloadVerification& verification)
+{
+   verification.Size  = 0;
+   verification.Error = 0;
+   const int fd = open(verification.FileName.c_str(), O_RDONLY);
+   struct stat status;
+   if( (fd < 0) || (fstat(fd, &status) != 0) || (!S_ISREG(status.st_mode)) ) {
+      if( (fd < 0) && (errno != ENOENT) && (errno != ENOTDIR) ) {
+         // The file exists, but cannot be opened (e.g. EACCES):
+         verification.Status = DownloadUnreadable;
+         verification.Error  = errno;
+      }
+      else {
+         verification.Status = DownloadMissing;
+      }
+      if(fd >= 0) {
+         close(fd);
+      }
+      return;
+   }
+   verification.Size = status.st_size;
+   if( (!verification.ExpectedSize.empty()) &&
+       (verification.ExpectedSize != format("%llu", verification.Size)) ) {
+      verification.Status = DownloadSizeMismatch;
+   }
+   else if(!verification.ExpectedMD5.empty()) {
+      verification.Error = computeMD5(fd, verification.Size, verification.MD5);
+      if(verification.Error != 0) {
+         verification.Status = DownloadUnreadable;
+      }
+      else {
+         verification.Status = (verification.MD5 == verification.ExpectedMD5) ?
+                                  DownloadOK : DownloadCorrupt;
+      }
+   }
+   else {
+      verification.Status = DownloadOK;
+   }
+   close(fd);
+}
+
+
+// ###### Verify stored downloads ###########################################
+// Only entries with url.mime are expected to have a stored download, since
+// the file name depends on the MIME type. The files are hashed in parallel;
+// the report is written in the order of the publication set.
+unsigned int verifyDownloads(PublicationSet* publicationSet,
+                             const char*     downloadDirectory,
+                             FILE*           reportFile,
+                             const bool      quietMode)
+{
+   // ====== Find the stored downloads ======================================
+   std::vector<DownloadVerification> verifications;
+   for(size_t index = 0; index < publicationSet->size(); index++) {
+      Node* publication = publicationSet->get(index);
+      if(publication->value == "Comment") {
+         continue;
+      }
+      const Node* urlMime = findChildNode(publication, "url.mime");
+      if(urlMime == nullptr) {
+         continue;
+      }
+      const Node* urlSize = findChildNode(publication, "url.size");
+      const Node* urlMD5  = findChildNode(publication, "url.md5");
+
+      DownloadVerification verification;
+      verification.Publication = publication;
+      verification.FileName    = PublicationSet::makeDownloadFileName(
+                                    downloadDirectory, publication->keyword, urlMime->value);
+      if(urlSize != nullptr) {
+         verification.ExpectedSize = urlSize->value;
+      }
+      if( (urlMD5 != nullptr) && (urlMD5->value != "ignore") ) {
+         verification.ExpectedMD5 = urlMD5->value;
+      }
+      verification.Status = DownloadOK;
+      verification.Size   = 0;
+      verification.Error  = 0;
+      verifications.push_back(verification);
+   }
+
+   // ====== Verify them in parallel ========================================
+   runInParallel(verifications.size(), [&](const size_t index) {
+      verifyDownload(verifications[index]);
+   });
+
+   // ====== Write the report ===============================================
+   // For an unreadable file, the md5 column contains the error.
+   unsigned int counts[5]     = { 0, 0, 0, 0, 0 };
+   bool         headerWritten = false;
+   for(const DownloadVerification& verification : verifications) {
+      counts[verification.Status]++;
+      if(verification.Status != DownloadOK) {
+         if(!headerWritten) {
+            // The header is only written if there is something to report:
+            fputs("# status\tanchor\tfile\texpected_size\tsize\texpected_md5\tmd5\n",
+                  reportFile);
+            headerWritten = true;
+         }
+         const bool hasSize = (verification.Status != DownloadMissing) &&
+                              ( (verification.Status != DownloadUnreadable) ||
+                                (verification.Size > 0) );
+         fprintf(reportFile, "%s\t%s\t%s\t%s\t%s\t%s\t%s\n",
+                 DownloadStatusNames[verification.Status],
+                 verification.Publication->keyword.c_str(),
+                 verification.FileName.c_str(),
+                 verification.ExpectedSize.empty() ? "-" : verification.ExpectedSize.c_str(),
+                 (hasSize) ? format("%llu", verification.Size).c_str() : "-",
+                 verification.ExpectedMD5.empty() ? "-" : verification.ExpectedMD5.c_str(),
+                 (verification.Status == DownloadUnreadable) ?
+                    strerror(verification.Error) :
+                    (verification.MD5.empty() ? "-" : verification.MD5.c_str()));
+      }
+   }
+   fflush(reportFile);
+
+   const unsigned int problems = counts[DownloadMissing] + counts[DownloadSizeMismatch] +
+                                 counts[DownloadCorrupt] + counts[DownloadUnreadable];
+   if( (!quietMode) || (problems > 0) ) {
+      fprintf(stderr, "Verified %u downloads: %u OK, %u missing, %u size mismatches, %u corrupt, %u unreadable.\n",
+              (unsigned int)verifications.size(), counts[DownloadOK],
+              counts[DownloadMissing], counts[DownloadSizeMismatch], counts[DownloadCorrupt],
+              counts[DownloadUnreadable]);
+   }
+   return problems;
+}
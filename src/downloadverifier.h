@@ -0,0 +1,48 @@
+// ==========================================================================
+//                ____  _ _   _____   __  ______
+//                | __ )(_) |_|_   _|__\ \/ / ___|___  _ ____   __
+//                |  _ \| | '_ \| |/ _ \  / |   / _ \| '_ \ \ / /
+//                | |_) | | |_) | |  __//  \ |__| (_) | | | \ V /
+//                |____/|_|_.__/|_|\___/_/\_\____\___/|_| |_|\_/
+//
+//                          ---  BibTeX Converter  ---
+//                   https://www.nntb.no/~dreibh/bibtexconv/
+// ==========================================================================
+//
+// BibTeX Converter
+// Copyright (C) 2010-2026 by Thomas Dreibholz
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Contact: thomas.dreibholz@gmail.com
+
+#ifndef DOWNLOADVERIFIER_H
+#define DOWNLOADVERIFIER_H
+
+#include <stdio.h>
+
+#include "publicationset.h"
+
+
+// Verifies the stored downloads of a publication set against their url.size
+// and url.md5, without any network access. A tab-separated report of the
+// problems (missing, size mismatch, corrupt, unreadable) is written to
+// reportFile, with a header line if there are any problems.
+// Returns the number of problems found.
+unsigned int verifyDownloads(PublicationSet* publicationSet,
+                             const char*     downloadDirectory,
+                             FILE*           reportFile,
+                             const bool      quietMode);
+
+#endif
@@ -31,6 +31,10 @@
 #include <stdio.h>
 #include "node.h"
 
+// The publication collection is right-recursive, i.e. the parser stack
+// grows with the number of entries. Allow for large databases:
+#define YYMAXDEPTH 1000000
+
 Node* bibTeXFile = nullptr;
 %}
 
@@ -92,7 +96,7 @@ bibTeXFile
 
 publicationCollection
     : publication publicationCollection  { $$ = makePublicationCollection($1, $2); }
-    | publication                        { $$ = $1; }
+    | publication                        { $$ = makePublicationCollection($1, NULL); }
     ;
 
 publication
@@ -31,9 +31,65 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+// ====== Binary mapping table file =========================================
+// The file consists of the header, followed by the column names (each one
+// terminated by 0x00), the string pool, the cells and the hash index of the
+// key column. All sections are 8-byte aligned, in host byte order.
+static const char     BinaryMappingMagic[8]   = { 'B', 'C', 'M', 'A', 'P', 0x00, 0x00, 0x02 };
+static const uint32_t BinaryMappingByteOrder  = 0x01020304;
+static const char*    BinaryMappingExtension  = ".bcm";
+
+struct BinaryMappingHeader {
+   char     Magic[8];
+   uint32_t ByteOrder;
+   uint32_t Columns;
+   uint32_t Rows;
+   uint32_t KeyColumn;
+   uint32_t IndexSize;
+   uint32_t Reserved;
+   uint64_t SourceSize;       // Size of the text file compiled
+   int64_t  SourceMTime;      // Modification time (in ns) of the text file
+   uint64_t SourceDevice;     // Device of the text file
+   uint64_t SourceInode;      // Inode of the text file
+   uint64_t NamesOffset;
+   uint64_t NamesLength;
+   uint64_t PoolOffset;
+   uint64_t PoolLength;
+   uint64_t CellsOffset;
+   uint64_t IndexOffset;
+};
+
+
+// ###### Get modification time of a file in nanoseconds ###################
+static int64_t getModificationTime(const struct stat& status)
+{
+#ifdef __APPLE__
+   return ((int64_t)status.st_mtimespec.tv_sec * 1000000000LL) + status.st_mtimespec.tv_nsec;
+#else
+   return ((int64_t)status.st_mtim.tv_sec * 1000000000LL) + status.st_mtim.tv_nsec;
+#endif
+}
+
+
+// ###### Check whether the status describes the compiled text file ########
+static bool isSameSource(const struct stat&         status,
+                         const BinaryMappingHeader* header)
+{
+   return ( ((uint64_t)status.st_size   == header->SourceSize)   &&
+            (getModificationTime(status) == header->SourceMTime)  &&
+            ((uint64_t)status.st_dev    == header->SourceDevice) &&
+            ((uint64_t)status.st_ino    == header->SourceInode) );
+}
 
 
 // ###### Constructor #######################################################
@@ -50,6 +106,11 @@ Mappings::~Mappings()
       delete iterator->second;
       iterator = MappingSet.erase(iterator);
    }
+   std::map<const std::string, MappingTable*>::iterator tableIterator = TableSet.begin();
+   while(tableIterator != TableSet.end()) {
+      deleteTable(tableIterator->second);
+      tableIterator = TableSet.erase(tableIterator);
+   }
 }
 
 
@@ -118,98 +179,462 @@ int Mappings::splitLine(const char**       columnArray,
 }
 
 
-// ###### Add mapping #######################################################
-bool Mappings::addMapping(const std::string& mappingName,
-                          const std::string& mappingFileName,
-                          const std::string& keyColumn,
-                          const std::string& valueColumn)
+// ###### Delete table ######################################################
+void Mappings::deleteTable(MappingTable* table)
+{
+   if(table->BinaryData != nullptr) {
+      munmap(table->BinaryData, table->BinarySize);
+   }
+   delete table;
+}
+
+
+// ###### Find column by name ###############################################
+int Mappings::findColumn(const MappingTable* table,
+                         const std::string&  columnName)
 {
-   FILE* mappingFile;
+   for(unsigned int i = 0; i < table->ColumnNames.size(); i++) {
+      if(table->ColumnNames[i] == columnName) {
+         return i;
+      }
+   }
+   return -1;
+}
+
 
-   mappingFile = fopen(mappingFileName.c_str(), "r");
+// ###### Load mapping file into table (or get already loaded one) #########
+MappingTable* Mappings::loadTable(const std::string& mappingFileName,
+                                  const bool         useBinaryTable)
+{
+   std::map<const std::string, MappingTable*>::const_iterator found =
+      TableSet.find(mappingFileName);
+   if(found != TableSet.end()) {
+      return found->second;
+   }
+
+   MappingTable* table = (useBinaryTable == true) ?
+                            loadBinaryTable(mappingFileName) : nullptr;
+   if(table == nullptr) {
+      table = loadTextTable(mappingFileName);
+   }
+   if(table != nullptr) {
+      TableSet.insert(std::pair<const std::string, MappingTable*>(mappingFileName, table));
+   }
+   return table;
+}
+
+
+// ###### Parse text mapping file into table ################################
+MappingTable* Mappings::loadTextTable(const std::string& mappingFileName)
+{
+   FILE* mappingFile = fopen(mappingFileName.c_str(), "r");
    if(mappingFile == nullptr) {
       fprintf(stderr, "ERROR: Unable to open mapping file %s: %s!\n",
                mappingFileName.c_str(), strerror(errno));
-      return false;
+      return nullptr;
    }
 
-   char    buffer[16384];
-   size_t  bufferSize = sizeof(buffer);
-   char*   line       = buffer;
-   ssize_t lineLength = getline((char**)&line, &bufferSize, mappingFile);
+   MappingTable* table = new MappingTable;
+   assert(table != nullptr);
+   table->FileName   = mappingFileName;
+   table->Rows       = 0;
+   table->BinaryData = nullptr;
+   table->BinarySize = 0;
+
+   const unsigned int                    maxColumns = 64;
+   const char*                           columnArray[maxColumns];
+   std::vector<std::vector<MappingCell>> columnCells;
+   char*                                 line       = nullptr;
+   size_t                                bufferSize = 0;
+   ssize_t                               lineLength = getline(&line, &bufferSize, mappingFile);
    if(lineLength >= 0) {
       // ====== Get columns names on first line =============================
-      const unsigned int maxColumns = 16;
-      const char*        columnArray[maxColumns];
       const unsigned int columnsInFile =
          splitLine((const char**)&columnArray, maxColumns,
                    line, lineLength);
-
-      // ====== Identify key and value column ===============================
-      int keyColumnIndex   = -1;
-      int valueColumnIndex = -1;
       for(unsigned int i = 0; i < columnsInFile; i++) {
-         if( (keyColumnIndex == -1) && (strcmp(columnArray[i], keyColumn.c_str()) == 0) ) {
-            keyColumnIndex = i;
-         }
-         if( (valueColumnIndex == -1) && (strcmp(columnArray[i], valueColumn.c_str()) == 0) ) {
-            valueColumnIndex = i;
-         }
-      }
-      if(keyColumnIndex < 0)  {
-         fprintf(stderr, "ERROR: Key column %s not found in mapping file %s!\n",
-                 keyColumn.c_str(), mappingFileName.c_str());
-         fclose(mappingFile);
-         return false;
-      }
-      if(valueColumnIndex < 0)  {
-         fprintf(stderr, "ERROR: Value column %s not found in mapping file %s!\n",
-                 valueColumn.c_str(), mappingFileName.c_str());
-         fclose(mappingFile);
-         return false;
+         table->ColumnNames.push_back(columnArray[i]);
       }
-
-      // ====== Add new mapping =============================================
-      MappingEntry* mappingEntry = new MappingEntry;
-      assert(mappingEntry != nullptr);
-      mappingEntry->Name = mappingName;
-      MappingSet.insert(std::pair<std::string, MappingEntry*>(
-         mappingEntry->Name, mappingEntry));
+      columnCells.resize(columnsInFile);
 
       // ====== Read data ===================================================
-      const unsigned int columnsToProcess =
-         1 + std::max(keyColumnIndex, valueColumnIndex);
-      assert(columnsToProcess <= maxColumns);
-      while( (lineLength = (getline((char**)&line, &bufferSize, mappingFile))) > 0 ) {
+      while( (lineLength = (getline(&line, &bufferSize, mappingFile))) > 0 ) {
          if(line[0] != '#') {
-            unsigned int columns =
-               splitLine((const char**)&columnArray, maxColumns,
-                        line, lineLength);
-            if(columns == columnsToProcess) {
-               const char* key   = columnArray[keyColumnIndex];
-               const char* value = columnArray[valueColumnIndex];
-               mappingEntry->Mappings.insert(
-                  std::pair<std::string, std::string>(
-                     std::string(key), std::string(value)));
+            const unsigned int columns =
+               splitLine((const char**)&columnArray, columnsInFile,
+                         line, lineLength);
+            if(columns > 0) {
+               for(unsigned int i = 0; i < columnsInFile; i++) {
+                  MappingCell cell;
+                  if(i < columns) {
+                     cell.Offset = table->PoolStorage.size();
+                     cell.Length = strlen(columnArray[i]);
+                     table->PoolStorage.append(columnArray[i], cell.Length);
+                  }
+                  else {
+                     cell.Offset = MissingCell;
+                     cell.Length = 0;
+                  }
+                  columnCells[i].push_back(cell);
+               }
+               table->Rows++;
+               if(table->PoolStorage.size() >= MissingCell) {
+                  fprintf(stderr, "ERROR: Mapping file %s is too large!\n",
+                          mappingFileName.c_str());
+                  free(line);
+                  fclose(mappingFile);
+                  deleteTable(table);
+                  return nullptr;
+               }
             }
          }
-         line = buffer;
       }
    }
+   free(line);
 
    // ====== Handle read errors =============================================
    if( (lineLength < 0) && (!feof(mappingFile)) ) {
       fprintf(stderr, "ERROR: Unable to read from mapping file %s: %s\n",
               mappingFileName.c_str(), strerror(errno));
       fclose(mappingFile);
+      deleteTable(table);
+      return nullptr;
+   }
+   fclose(mappingFile);
+
+   // ====== Store cells column by column ===================================
+   table->CellStorage.reserve(columnCells.size() * (size_t)table->Rows);
+   for(const std::vector<MappingCell>& cells : columnCells) {
+      table->CellStorage.insert(table->CellStorage.end(), cells.begin(), cells.end());
+   }
+   table->Pool  = table->PoolStorage.data();
+   table->Cells = table->CellStorage.data();
+   return table;
+}
+
+
+// ###### Map precompiled binary mapping file into table ####################
+// Returns nullptr if there is no usable binary file; the text file has to
+// be parsed then.
+MappingTable* Mappings::loadBinaryTable(const std::string& mappingFileName)
+{
+   const std::string binaryFileName = mappingFileName + BinaryMappingExtension;
+   const int         fd             = open(binaryFileName.c_str(), O_RDONLY);
+   if(fd < 0) {
+      return nullptr;
+   }
+
+   // ====== Map the file ===================================================
+   struct stat binaryStatus;
+   void*       data = MAP_FAILED;
+   if( (fstat(fd, &binaryStatus) == 0) &&
+       (binaryStatus.st_size >= (off_t)sizeof(BinaryMappingHeader)) ) {
+      data = mmap(nullptr, binaryStatus.st_size, PROT_READ, MAP_SHARED, fd, 0);
+   }
+   close(fd);
+   if(data == MAP_FAILED) {
+      fprintf(stderr, "WARNING: Unable to map binary mapping file %s, using %s!\n",
+              binaryFileName.c_str(), mappingFileName.c_str());
+      return nullptr;
+   }
+   const size_t               size   = binaryStatus.st_size;
+   const BinaryMappingHeader* header = (const BinaryMappingHeader*)data;
+
+   // ====== Check header ===================================================
+   const uint64_t cellsLength = (uint64_t)header->Columns * header->Rows * sizeof(MappingCell);
+   const uint64_t indexLength = (uint64_t)header->IndexSize * sizeof(MappingSlot);
+   if( (memcmp(header->Magic, BinaryMappingMagic, sizeof(BinaryMappingMagic)) != 0) ||
+       (header->ByteOrder != BinaryMappingByteOrder) ||
+       (header->KeyColumn >= header->Columns) ||
+       (header->IndexSize == 0) ||
+       ((header->IndexSize & (header->IndexSize - 1)) != 0) ||
+       (header->NamesOffset > size) || (header->NamesLength > size - header->NamesOffset) ||
+       (header->PoolOffset  > size) || (header->PoolLength  > size - header->PoolOffset) ||
+       (header->CellsOffset > size) || (cellsLength         > size - header->CellsOffset) ||
+       (header->IndexOffset > size) || (indexLength         > size - header->IndexOffset) ) {
+      fprintf(stderr, "WARNING: Invalid binary mapping file %s, using %s!\n",
+              binaryFileName.c_str(), mappingFileName.c_str());
+      munmap(data, size);
+      return nullptr;
+   }
+
+   // ====== Check whether it is up to date =================================
+   // If the text file is not available, the binary file is used as is.
+   struct stat sourceStatus;
+   if( (stat(mappingFileName.c_str(), &sourceStatus) == 0) &&
+       (!isSameSource(sourceStatus, header)) ) {
+      fprintf(stderr, "NOTE: Binary mapping file %s is outdated, using %s!\n",
+              binaryFileName.c_str(), mappingFileName.c_str());
+      munmap(data, size);
+      return nullptr;
+   }
+
+   // ====== Check cells and index ==========================================
+   // Every cell has to lie within the pool, and every slot has to refer to
+   // an existing row. At least one slot has to be empty, to terminate the
+   // linear probing in map().
+   const MappingCell* cells     = (const MappingCell*)((const char*)data + header->CellsOffset);
+   const MappingSlot* slots     = (const MappingSlot*)((const char*)data + header->IndexOffset);
+   const uint64_t     cellCount = (uint64_t)header->Columns * header->Rows;
+   bool               valid     = true;
+   for(uint64_t i = 0; i < cellCount; i++) {
+      if( (cells[i].Offset != MissingCell) &&
+          ( (cells[i].Offset > header->PoolLength) ||
+            (cells[i].Length > header->PoolLength - cells[i].Offset) ) ) {
+         valid = false;
+         break;
+      }
+   }
+   bool hasEmptySlot = false;
+   for(uint64_t i = 0; valid && (i < header->IndexSize); i++) {
+      if(slots[i].Row == EmptySlot) {
+         hasEmptySlot = true;
+      }
+      else if(slots[i].Row >= header->Rows) {
+         valid = false;
+      }
+   }
+   if( (!valid) || (!hasEmptySlot) ) {
+      fprintf(stderr, "WARNING: Invalid binary mapping file %s, using %s!\n",
+              binaryFileName.c_str(), mappingFileName.c_str());
+      munmap(data, size);
+      return nullptr;
+   }
+
+   // ====== Set up table ===================================================
+   MappingTable* table = new MappingTable;
+   assert(table != nullptr);
+   table->FileName   = mappingFileName;
+   table->Rows       = header->Rows;
+   table->Pool       = (const char*)data + header->PoolOffset;
+   table->Cells      = (const MappingCell*)((const char*)data + header->CellsOffset);
+   table->BinaryData = data;
+   table->BinarySize = size;
+   const char* names    = (const char*)data + header->NamesOffset;
+   const char* namesEnd = names + header->NamesLength;
+   while( (names < namesEnd) && (table->ColumnNames.size() < header->Columns) ) {
+      const size_t length = strnlen(names, namesEnd - names);
+      table->ColumnNames.push_back(std::string(names, length));
+      names += length + 1;
+   }
+   if(table->ColumnNames.size() != header->Columns) {
+      fprintf(stderr, "WARNING: Invalid binary mapping file %s, using %s!\n",
+              binaryFileName.c_str(), mappingFileName.c_str());
+      deleteTable(table);
+      return nullptr;
+   }
+
+   MappingIndex& keyIndex = table->KeyIndexes[header->KeyColumn];
+   keyIndex.Slots = (const MappingSlot*)((const char*)data + header->IndexOffset);
+   keyIndex.Size  = header->IndexSize;
+   return table;
+}
+
+
+// ###### Get hash index of key column (or build it) ########################
+const MappingIndex* Mappings::getKeyIndex(MappingTable*      table,
+                                          const unsigned int keyColumn)
+{
+   std::map<unsigned int, MappingIndex>::const_iterator found =
+      table->KeyIndexes.find(keyColumn);
+   if(found != table->KeyIndexes.end()) {
+      return &found->second;
+   }
+
+   // ====== Size the table for a load factor below 3/4 =====================
+   size_t slots = 64;
+   while(4 * (size_t)table->Rows >= 3 * slots) {
+      slots *= 2;
+   }
+   const size_t  mask     = slots - 1;
+   MappingIndex& keyIndex = table->KeyIndexes[keyColumn];
+   keyIndex.Storage.assign(slots, MappingSlot { EmptySlot, 0 });
+   keyIndex.Slots = keyIndex.Storage.data();
+   keyIndex.Size  = slots;
+
+   // ====== Insert all rows in file order ==================================
+   // Rows with the same key are probed in file order, so the first row with
+   // the key (and the requested value column) wins.
+   for(uint32_t row = 0; row < table->Rows; row++) {
+      if(hasCell(table, keyColumn, row)) {
+         const uint32_t hash = hashKey(getCell(table, keyColumn, row), std::string());
+         size_t         slot = hash & mask;
+         while(keyIndex.Storage[slot].Row != EmptySlot) {
+            slot = (slot + 1) & mask;
+         }
+         keyIndex.Storage[slot].Row  = row;
+         keyIndex.Storage[slot].Hash = hash;
+      }
+   }
+   return &keyIndex;
+}
+
+
+// ###### Add mapping #######################################################
+bool Mappings::addMapping(const std::string& mappingName,
+                          const std::string& mappingFileName,
+                          const std::string& keyColumn,
+                          const std::string& valueColumn)
+{
+   MappingTable* table = loadTable(mappingFileName, true);
+   if(table == nullptr) {
       return false;
    }
 
-   fclose(mappingFile);
+   // ====== Identify key and value column ==================================
+   const int keyColumnIndex   = findColumn(table, keyColumn);
+   const int valueColumnIndex = findColumn(table, valueColumn);
+   if(keyColumnIndex < 0)  {
+      fprintf(stderr, "ERROR: Key column %s not found in mapping file %s!\n",
+              keyColumn.c_str(), mappingFileName.c_str());
+      return false;
+   }
+   if(valueColumnIndex < 0)  {
+      fprintf(stderr, "ERROR: Value column %s not found in mapping file %s!\n",
+              valueColumn.c_str(), mappingFileName.c_str());
+      return false;
+   }
+
+   // ====== Add new mapping ================================================
+   if(MappingSet.find(mappingName) == MappingSet.end()) {
+      MappingEntry* mappingEntry = new MappingEntry;
+      assert(mappingEntry != nullptr);
+      mappingEntry->Name        = mappingName;
+      mappingEntry->Table       = table;
+      mappingEntry->KeyColumn   = keyColumnIndex;
+      mappingEntry->ValueColumn = valueColumnIndex;
+      mappingEntry->KeyIndex    = getKeyIndex(table, keyColumnIndex);
+      MappingSet.insert(std::pair<const std::string, MappingEntry*>(
+         mappingEntry->Name, mappingEntry));
+   }
+   return true;
+}
+
+
+// ###### Write section to binary mapping file, with 8-byte alignment #######
+static bool writeSection(FILE* file, const void* data, const size_t length,
+                         uint64_t& offset)
+{
+   static const char padding[8] = { 0 };
+   const size_t      pad        = (8 - (length % 8)) % 8;
+   if( (fwrite(data, 1, length, file) != length) ||
+       (fwrite(padding, 1, pad, file) != pad) ) {
+      return false;
+   }
+   offset += length + pad;
    return true;
 }
 
 
+// ###### Compile text mapping file into binary mapping file ################
+bool Mappings::compileMapping(const std::string& mappingFileName,
+                              const std::string& keyColumn)
+{
+   // ====== Wait until the text file is at least 1 s old ==================
+   // A modification after compiling then certainly gets a different
+   // modification time, even with coarse timestamp granularity.
+   struct stat sourceStatus;
+   if(stat(mappingFileName.c_str(), &sourceStatus) != 0) {
+      fprintf(stderr, "ERROR: Unable to open mapping file %s: %s!\n",
+               mappingFileName.c_str(), strerror(errno));
+      return false;
+   }
+   struct timespec now;
+   clock_gettime(CLOCK_REALTIME, &now);
+   const int64_t age = (((int64_t)now.tv_sec * 1000000000LL) + now.tv_nsec) -
+                          getModificationTime(sourceStatus);
+   if( (age >= 0) && (age < 1000000000LL) ) {
+      const struct timespec delay = { 0, (long)(1000000000LL - age) };
+      nanosleep(&delay, nullptr);
+   }
+
+   // ====== Load the text file =============================================
+   MappingTable* table = loadTextTable(mappingFileName);
+   if(table == nullptr) {
+      return false;
+   }
+   BinaryMappingHeader header;
+   memset(&header, 0, sizeof(header));
+   header.SourceSize   = sourceStatus.st_size;
+   header.SourceMTime  = getModificationTime(sourceStatus);
+   header.SourceDevice = sourceStatus.st_dev;
+   header.SourceInode  = sourceStatus.st_ino;
+   if( (stat(mappingFileName.c_str(), &sourceStatus) != 0) ||
+       (!isSameSource(sourceStatus, &header)) ) {
+      fprintf(stderr, "ERROR: Mapping file %s has changed while compiling it!\n",
+              mappingFileName.c_str());
+      deleteTable(table);
+      return false;
+   }
+   const int keyColumnIndex = findColumn(table, keyColumn);
+   if(keyColumnIndex < 0)  {
+      fprintf(stderr, "ERROR: Key column %s not found in mapping file %s!\n",
+              keyColumn.c_str(), mappingFileName.c_str());
+      deleteTable(table);
+      return false;
+   }
+   const MappingIndex* keyIndex = getKeyIndex(table, keyColumnIndex);
+
+   // ====== Prepare header =================================================
+   std::string names;
+   for(const std::string& columnName : table->ColumnNames) {
+      names += columnName;
+      names += '\0';
+   }
+   const size_t poolLength  = table->PoolStorage.size();
+   const size_t cellsLength = table->ColumnNames.size() * (size_t)table->Rows * sizeof(MappingCell);
+   const size_t indexLength = keyIndex->Size * sizeof(MappingSlot);
+
+   memcpy(header.Magic, BinaryMappingMagic, sizeof(BinaryMappingMagic));
+   header.ByteOrder   = BinaryMappingByteOrder;
+   header.Columns     = table->ColumnNames.size();
+   header.Rows        = table->Rows;
+   header.KeyColumn   = keyColumnIndex;
+   header.IndexSize   = keyIndex->Size;
+
+   // ====== Write to temporary file, then rename it ========================
+   const std::string binaryFileName = mappingFileName + BinaryMappingExtension;
+   // The temporary file is created like by fopen(), i.e. with the umask
+   // applied to 0666:
+   const std::string tempFileName   = binaryFileName + "." + std::to_string(getpid());
+   const int         fd             = open(tempFileName.c_str(),
+                                           O_WRONLY|O_CREAT|O_EXCL|O_CLOEXEC, 0666);
+   FILE*             file           = (fd >= 0) ? fdopen(fd, "w") : nullptr;
+   bool              success        = (file != nullptr);
+   if(success) {
+      uint64_t offset = 0;
+      header.NamesOffset = sizeof(header) + ((8 - (sizeof(header) % 8)) % 8);
+      header.NamesLength = names.size();
+      header.PoolOffset  = header.NamesOffset + names.size() + ((8 - (names.size() % 8)) % 8);
+      header.PoolLength  = poolLength;
+      header.CellsOffset = header.PoolOffset + poolLength + ((8 - (poolLength % 8)) % 8);
+      header.IndexOffset = header.CellsOffset + cellsLength;
+      success = writeSection(file, &header, sizeof(header), offset) &&
+                writeSection(file, names.data(), names.size(), offset) &&
+                writeSection(file, table->Pool, poolLength, offset) &&
+                writeSection(file, table->Cells, cellsLength, offset) &&
+                writeSection(file, keyIndex->Slots, indexLength, offset);
+      assert( (!success) || (offset == header.IndexOffset + indexLength) );
+      success = (fclose(file) == 0) && success;
+      if(success) {
+         success = (rename(tempFileName.c_str(), binaryFileName.c_str()) == 0);
+      }
+   }
+   else if(fd >= 0) {
+      close(fd);
+   }
+   if(!success) {
+      fprintf(stderr, "ERROR: Unable to write binary mapping file %s: %s!\n",
+              binaryFileName.c_str(), strerror(errno));
+      if(fd >= 0) {
+         unlink(tempFileName.c_str());
+      }
+   }
+   deleteTable(table);
+   return success;
+}
+
+
 // ###### Apply mapping #####################################################
 const MappingEntry* Mappings::findMapping(const std::string& mappingName) const
 {
@@ -221,16 +646,85 @@ const MappingEntry* Mappings::findMapping(const std::string& mappingName) const
 }
 
 
+// ###### Get next character of key, with nbsp folded to ' ' ###############
+static inline char nextKeyCharacter(const std::string_view key,
+                                    size_t&                i,
+                                    const std::string&     nbsp)
+{
+   const size_t nbspLength = nbsp.size();
+   if( (nbspLength > 0) && (key[i] == nbsp[0]) &&
+       (key.compare(i, nbspLength, nbsp) == 0) ) {
+      i += nbspLength;
+      return ' ';
+   }
+   return key[i++];
+}
+
+
+// ###### Compute hash of key (FNV-1a), with nbsp folded to ' ' #############
+uint32_t Mappings::hashKey(const std::string_view key,
+                           const std::string&     nbsp)
+{
+   uint32_t hash = 2166136261U;
+   size_t   i    = 0;
+   while(i < key.size()) {
+      hash = (hash ^ (unsigned char)nextKeyCharacter(key, i, nbsp)) * 16777619U;
+   }
+   return hash;
+}
+
+
+// ###### Compare stored key to key, with nbsp folded to ' ' ################
+static bool keyEquals(const std::string_view storedKey,
+                      const std::string_view key,
+                      const std::string&     nbsp)
+{
+   size_t i = 0;
+   size_t j = 0;
+   while(i < key.size()) {
+      if( (j >= storedKey.size()) ||
+          (storedKey[j++] != nextKeyCharacter(key, i, nbsp)) ) {
+         return false;
+      }
+   }
+   return (j == storedKey.size());
+}
+
+
+// ###### Apply mapping #####################################################
+bool Mappings::map(const MappingEntry*    mappingEntry,
+                   const std::string_view key,
+                   const std::string&     nbsp,
+                   std::string_view&      value) const
+{
+   assert(mappingEntry != nullptr);
+   const MappingTable* table = mappingEntry->Table;
+   const MappingSlot*  slots = mappingEntry->KeyIndex->Slots;
+   const uint32_t      hash  = hashKey(key, nbsp);
+   const size_t        mask  = mappingEntry->KeyIndex->Size - 1;
+   size_t              slot  = hash & mask;
+   while(slots[slot].Row != EmptySlot) {
+      const uint32_t row = slots[slot].Row;
+      if( (slots[slot].Hash == hash) &&
+          (hasCell(table, mappingEntry->ValueColumn, row)) &&
+          (keyEquals(getCell(table, mappingEntry->KeyColumn, row), key, nbsp)) ) {
+         value = getCell(table, mappingEntry->ValueColumn, row);
+         return true;
+      }
+      slot = (slot + 1) & mask;
+   }
+   return false;
+}
+
+
 // ###### Apply mapping #####################################################
 bool Mappings::map(const MappingEntry* mappingEntry,
                    const std::string&  key,
                    std::string&        value) const
 {
-   assert(mappingEntry != nullptr);
-   std::map<const std::string, const std::string>::const_iterator found =
-      mappingEntry->Mappings.find(key);
-   if(found != mappingEntry->Mappings.end()) {
-      value = found->second;
+   std::string_view mappedValue;
+   if(map(mappingEntry, key, std::string(), mappedValue)) {
+      value = mappedValue;
       return true;
    }
    return false;
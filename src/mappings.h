@@ -30,13 +30,54 @@
 #ifndef MAPPINGS_H
 #define MAPPINGS_H
 
+#include <stdint.h>
+
 #include <map>
 #include <string>
+#include <string_view>
+#include <vector>
+
+
+// A mapping file is parsed only once, into a shared MappingTable. All of
+// its cells are kept in one string pool, in a columnar layout. The table
+// is either parsed from the text file, or mmap()ed from its precompiled
+// binary version (see Mappings::compileMapping()).
+struct MappingCell {
+   uint32_t Offset;   // MissingCell, if the row does not have this column
+   uint32_t Length;
+};
+
+// Open-addressing hash table (linear probing) over the rows of a table.
+struct MappingSlot {
+   uint32_t Row;      // EmptySlot, if unused
+   uint32_t Hash;
+};
 
+struct MappingIndex {
+   const MappingSlot*       Slots;
+   uint32_t                 Size;      // Number of slots (power of 2)
+   std::vector<MappingSlot> Storage;   // Empty, if in binary table
+};
+
+struct MappingTable {
+   std::string                          FileName;
+   std::vector<std::string>             ColumnNames;
+   uint32_t                             Rows;
+   const char*                          Pool;
+   const MappingCell*                   Cells;         // [column * Rows + row]
+   std::string                          PoolStorage;   // Empty, if binary table
+   std::vector<MappingCell>             CellStorage;   // Empty, if binary table
+   void*                                BinaryData;    // mmap()ed binary table
+   size_t                               BinarySize;
+   std::map<unsigned int, MappingIndex> KeyIndexes;
+};
 
 struct MappingEntry {
-   std::string                                    Name;
-   std::map<const std::string, const std::string> Mappings;
+   std::string         Name;
+   const MappingTable* Table;
+   unsigned int        KeyColumn;
+   unsigned int        ValueColumn;
+   const MappingIndex* KeyIndex;
 };
 
 class Mappings
@@ -49,21 +90,53 @@ class Mappings
                    const std::string& mappingFile,
                    const std::string& keyColumn,
                    const std::string& valueColumn);
+   bool compileMapping(const std::string& mappingFile,
+                       const std::string& keyColumn);
    const MappingEntry* findMapping(const std::string& mappingName) const;
    bool map(const MappingEntry* mappingEntry,
             const std::string&  key,
             std::string&        value) const;
+   bool map(const MappingEntry*    mappingEntry,
+            const std::string_view key,
+            const std::string&     nbsp,
+            std::string_view&      value) const;
 
    private:
+   static constexpr uint32_t MissingCell = 0xffffffff;
+   static constexpr uint32_t EmptySlot   = 0xffffffff;
+
    std::map<const std::string, MappingEntry*> MappingSet;
+   std::map<const std::string, MappingTable*> TableSet;
 
    static inline bool isDelimiter(const char c) {
       return ( (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r') );
    }
+   static inline std::string_view getCell(const MappingTable* table,
+                                          const unsigned int  column,
+                                          const uint32_t      row) {
+      const MappingCell& cell = table->Cells[(size_t)column * table->Rows + row];
+      return std::string_view(&table->Pool[cell.Offset], cell.Length);
+   }
+   static inline bool hasCell(const MappingTable* table,
+                              const unsigned int  column,
+                              const uint32_t      row) {
+      return (table->Cells[(size_t)column * table->Rows + row].Offset != MissingCell);
+   }
    static int splitLine(const char**       columnArray,
                         const unsigned int maxColumns,
                         char*              line,
                         const unsigned int lineLength);
+   static uint32_t hashKey(const std::string_view key,
+                           const std::string&     nbsp);
+   static int findColumn(const MappingTable* table,
+                         const std::string&  columnName);
+   MappingTable* loadTable(const std::string& mappingFileName,
+                           const bool         useBinaryTable);
+   static MappingTable* loadTextTable(const std::string& mappingFileName);
+   static MappingTable* loadBinaryTable(const std::string& mappingFileName);
+   static void deleteTable(MappingTable* table);
+   static const MappingIndex* getKeyIndex(MappingTable*      table,
+                                          const unsigned int keyColumn);
 };
 
 #endif
@@ -0,0 +1,232 @@
+// ==========================================================================
+//                ____  _ _   _____   __  ______
+//                | __ )(_) |_|_   _|__\ \/ / ___|___  _ ____   __
+//                |  _ \| | '_ \| |/ _ \  / |   / _ \| '_ \ \ / /
+//                | |_) | | |_) | |  __//  \ |__| (_) | | | \ V /
+//                |____/|_|_.__/|_|\___/_/\_\____\___/|_| |_|\_/
+//
+//                          ---  BibTeX Converter  ---
+//                   https://www.nntb.no/~dreibh/bibtexconv/
+// ==========================================================================
+//
+// BibTeX Converter
+// Copyright (C) 2010-2026 by Thomas Dreibholz
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Contact: thomas.dreibholz@gmail.com
+
+#include "mimetype.h"
+
+#include <string.h>
+#include <strings.h>
+
+#ifdef HAVE_LIBMAGIC
+#include <magic.h>
+#endif
+
+
+#ifdef HAVE_LIBMAGIC
+// A libmagic cookie must not be shared between threads. Each thread gets
+// its own one, which is closed when the thread exits.
+class MagicCookie
+{
+   public:
+   MagicCookie() {
+      Cookie = magic_open(MAGIC_MIME_TYPE);
+      if( (Cookie != nullptr) && (magic_load(Cookie, nullptr) != 0) ) {
+         magic_close(Cookie);
+         Cookie = nullptr;
+      }
+   }
+   ~MagicCookie() {
+      if(Cookie != nullptr) {
+         magic_close(Cookie);
+      }
+   }
+   magic_t Cookie;
+};
+#endif
+
+
+// ###### Check for string at given position ################################
+static inline bool hasString(const char*  data,
+                             const size_t length,
+                             const size_t offset,
+                             const char*  string)
+{
+   const size_t stringLength = strlen(string);
+   return ( (offset + stringLength <= length) &&
+            (memcmp(&data[offset], string, stringLength) == 0) );
+}
+
+
+// ###### Find string (case-insensitive) in the first bytes #################
+static bool findString(const char*  data,
+                       const size_t length,
+                       const char*  string,
+                       const size_t maxOffset)
+{
+   const size_t stringLength = strlen(string);
+   for(size_t i = 0; (i <= maxOffset) && (i + stringLength <= length); i++) {
+      if(strncasecmp(&data[i], string, stringLength) == 0) {
+         return true;
+      }
+   }
+   return false;
+}
+
+
+// ###### Get little-endian number from ZIP header ##########################
+static inline unsigned int getLE(const char* data, const size_t bytes)
+{
+   unsigned int value = 0;
+   for(size_t i = 0; i < bytes; i++) {
+      value |= (unsigned int)(unsigned char)data[i] << (8 * i);
+   }
+   return value;
+}
+
+
+// ###### Check whether data looks like text ################################
+static bool isText(const char* data, const size_t length)
+{
+   for(size_t i = 0; i < length; i++) {
+      const unsigned char c = (unsigned char)data[i];
+      if( (c < 0x20) && (c != '\t') && (c != '\n') && (c != '\r') &&
+          (c != '\f') && (c != 0x1b) ) {
+         return false;
+      }
+      else if(c == 0x7f) {
+         return false;
+      }
+   }
+   return true;
+}
+
+
+// ###### Built-in MIME type detection for the common document types #######
+static std::string sniffMIMEType(const char* data, const size_t length)
+{
+   if(length == 0) {
+      return "application/x-empty";
+   }
+
+   // ====== Binary formats =================================================
+   if(hasString(data, length, 0, "%PDF-")) {
+      return "application/pdf";
+   }
+   if( (hasString(data, length, 0, "%!PS")) ||
+       (hasString(data, length, 0, "\004%!PS")) ) {
+      return "application/postscript";
+   }
+   if(hasString(data, length, 0, "PK\003\004")) {
+      // ODF and EPUB files store their type in a first entry "mimetype":
+      if( (length >= 30) && (hasString(data, length, 30, "mimetype")) ) {
+         const size_t offset = 30 + getLE(&data[26], 2) + getLE(&data[28], 2);
+         const size_t size   = getLE(&data[18], 4);
+         if( (size > 0) && (size < 128) && (offset + size <= length) ) {
+            return std::string(&data[offset], size);
+         }
+      }
+      // Office Open XML files have a [Content_Types].xml entry:
+      if(findString(data, length, "[Content_Types].xml", length)) {
+         if(findString(data, length, "word/", length)) {
+            return "application/vnd.openxmlformats-officedocument.wordprocessingml.document";
+         }
+         if(findString(data, length, "ppt/", length)) {
+            return "application/vnd.openxmlformats-officedocument.presentationml.presentation";
+         }
+         if(findString(data, length, "xl/", length)) {
+            return "application/vnd.openxmlformats-officedocument.spreadsheetml.sheet";
+         }
+      }
+      return "application/zip";
+   }
+   if(hasString(data, length, 0, "\211PNG\r\n\032\n")) {
+      return "image/png";
+   }
+   if(hasString(data, length, 0, "\377\330\377")) {
+      return "image/jpeg";
+   }
+   if( (hasString(data, length, 0, "GIF87a")) ||
+       (hasString(data, length, 0, "GIF89a")) ) {
+      return "image/gif";
+   }
+   if(hasString(data, length, 0, "\037\213")) {
+      return "application/gzip";
+   }
+
+   // ====== Text formats ===================================================
+   size_t start = 0;
+   if(hasString(data, length, 0, "\357\273\277")) {   // UTF-8 BOM
+      start = 3;
+   }
+   while( (start < length) &&
+          ( (data[start] == ' ')  || (data[start] == '\t') ||
+            (data[start] == '\r') || (data[start] == '\n') ) ) {
+      start++;
+   }
+   const char*  text       = &data[start];
+   const size_t textLength = length - start;
+   if( (findString(text, textLength, "<!DOCTYPE html", 0)) ||
+       (findString(text, textLength, "<html", 0)) ||
+       (findString(text, textLength, "<head", 0)) ||
+       (findString(text, textLength, "<title", 0)) ||
+       (findString(text, textLength, "<body", 0)) ||
+       ( (textLength > 0) && (text[0] == '<') &&
+         (findString(text, textLength, "<html", 1024)) ) ) {
+      return "text/html";
+   }
+   if( (findString(text, textLength, "<svg", 0)) ||
+       ( (textLength > 0) && (text[0] == '<') &&
+         (findString(text, textLength, "<svg", 4096)) ) ) {
+      return "image/svg+xml";
+   }
+   if(findString(text, textLength, "<?xml", 0)) {
+      return "text/xml";
+   }
+   if(isText(data, length)) {
+      return "text/plain";
+   }
+   return "application/octet-stream";
+}
+
+
+// ###### Get MIME type of data #############################################
+std::string getMIMEType(const char* data, const size_t length)
+{
+   std::string mimeType;
+
+#ifdef HAVE_LIBMAGIC
+   static thread_local MagicCookie magicCookie;
+   if(magicCookie.Cookie != nullptr) {
+      const char* result = magic_buffer(magicCookie.Cookie, data, length);
+      if(result != nullptr) {
+         mimeType = result;
+      }
+   }
+#endif
+   if(mimeType.empty()) {
+      mimeType = sniffMIMEType(data, length);
+   }
+
+   // RFCs/I-Ds are sometimes misidentified as source code:
+   if( (mimeType == "text/x-pascal") ||
+       (mimeType == "text/x-c") ||
+       (mimeType == "text/x-c++") ) {
+      mimeType = "text/plain";
+   }
+   return mimeType;
+}
@@ -32,8 +32,10 @@
 #include <string.h>
 #include <assert.h>
 
+#include <string>
+#include <unordered_map>
+
 #include "node.h"
-#include "unification.h"
 #include "stringhandling.h"
 
 
@@ -44,12 +46,14 @@ static Node* createNode(const char* label)
    if(node == nullptr) {
       yyerror("out of memory");
    }
-   node->keyword  = label;
-   node->number   = 0;
-   node->prev     = nullptr;
-   node->next     = nullptr;
-   node->child    = nullptr;
-   node->priority = 0;
+   node->keyword    = label;
+   node->number     = 0;
+   node->prev       = nullptr;
+   node->next       = nullptr;
+   node->child      = nullptr;
+   node->priority   = 0;
+   node->unified    = false;
+   node->urlChecked = false;
    return node;
 }
 
@@ -156,53 +160,65 @@ size_t countChildNodes(const Node* node, const char* childKeyword)
 }
 
 
+// NOTE: makePublicationCollection() will *NOT* be thread-safe!
+// Index of the keywords in the collection built so far. Since the grammar
+// is right-recursive, the collection is built from its last entry.
+static std::unordered_map<std::string, Node*> gCollectionIndex;
+
+
 // ###### Make publication collection #######################################
 Node* makePublicationCollection(Node* node1, Node* node2)
 {
+   if(node2 == nullptr) {
+      // Last entry of the input -> begin a new collection.
+      gCollectionIndex.clear();
+   }
+
    // ====== If there is already an existing node, clear and use it =========
-   Node* n = node2;
-   while(n != nullptr) {
-      if(n->keyword == node1->keyword) {
-
-         const Node* oldTitle = findChildNode(node1, "title");
-         Node*       newTitle = findChildNode(n, "title");
-         if( (oldTitle != nullptr) && (newTitle != nullptr) && (oldTitle->value != newTitle->value) ) {
-            fprintf(stderr, "NOTE: Duplicate entry %s; keeping the old title but updating the rest!\nOld = \"%s\"\nNew = \"%s\"\n",
-                    n->keyword.c_str(),
-                    oldTitle->value.c_str(),
-                    newTitle->value.c_str());
-            newTitle->value = oldTitle->value;
-         }
-         else {
-            fprintf(stderr, "NOTE: Duplicate entry %s, only keeping the latest one!\n",
-                    n->keyword.c_str());
-         }
+   std::unordered_map<std::string, Node*>::iterator found =
+      gCollectionIndex.find(node1->keyword);
+   if(found != gCollectionIndex.end()) {
+      Node* n = found->second;
+
+      const Node* oldTitle = findChildNode(node1, "title");
+      Node*       newTitle = findChildNode(n, "title");
+      if( (oldTitle != nullptr) && (newTitle != nullptr) && (oldTitle->value != newTitle->value) ) {
+         fprintf(stderr, "NOTE: Duplicate entry %s; keeping the old title but updating the rest!\nOld = \"%s\"\nNew = \"%s\"\n",
+                 n->keyword.c_str(),
+                 oldTitle->value.c_str(),
+                 newTitle->value.c_str());
+         newTitle->value = oldTitle->value;
+      }
+      else {
+         fprintf(stderr, "NOTE: Duplicate entry %s, only keeping the latest one!\n",
+                 n->keyword.c_str());
+      }
 
-         // node1 is old. Remove its contents, but reuse it for newer data.
-         freeNode(node1->child);
-         node1->child = n->child;
-         n->child     = nullptr;
+      // node1 is old. Remove its contents, but reuse it for newer data.
+      freeNode(node1->child);
+      node1->child = n->child;
+      n->child     = nullptr;
 
-         // Get rid of old node n.
-         if(n->prev) {
-            n->prev->next = n->next;
-         }
-         if(n->next) {
-            n->next->prev = n->prev;
-            if(n == node2) {
-               node2 = n->next;
-            }
+      // Get rid of old node n.
+      if(n->prev) {
+         n->prev->next = n->next;
+      }
+      if(n->next) {
+         n->next->prev = n->prev;
+         if(n == node2) {
+            node2 = n->next;
          }
-         else {
-            if(n == node2) {
-               node2 = nullptr;
-            }
+      }
+      else {
+         if(n == node2) {
+            node2 = nullptr;
          }
-         delete n;
-
-         break;
       }
-      n = n->next;
+      delete n;
+      found->second = node1;
+   }
+   else {
+      gCollectionIndex.insert(std::pair<std::string, Node*>(node1->keyword, node1));
    }
 
    // ====== Add a new node =================================================
@@ -236,7 +252,7 @@ int nodeComparisonFunction(const void* node1ptr, const void* node2ptr)
 
 
 // ###### Sort children of node #############################################
-static void sortChildren(Node* node)
+void sortChildren(Node* node)
 {
    Node* child = node->child;
    if(child) {
@@ -287,29 +303,6 @@ Node* addOrUpdateChildNode(Node* node, const char* childKeyword, const char* val
 }
 
 
-// ###### Check number of occurrences for a field ###########################
-static bool requiresField(const Node* publication,
-                          const char* field,
-                          const size_t minimum,
-                          const size_t maximum)
-{
-   const size_t count = countChildNodes(publication, field);
-   if(count < minimum) {
-      fprintf(stderr, "WARNING: Entry %s has no \"%s\" section!\n",
-              publication->keyword.c_str(),
-              field);
-      return false;
-   }
-   else if(count > maximum) {
-      fprintf(stderr, "WARNING: Entry %s has %u \"%s\" sections!\n",
-              publication->keyword.c_str(),
-              (unsigned int)count, field);
-      return false;
-   }
-   return true;
-}
-
-
 // ###### Make publication ##################################################
 Node* makePublication(const char* type, const char* label, Node* publicationInfo)
 {
@@ -328,104 +321,9 @@ Node* makePublication(const char* type, const char* label, Node* publicationInfo
    publication->child = publicationInfo;
    publication->value = type;
 
-   sortChildren(publication);
-
-   if(publication->value != "Comment") {
-      requiresField(publication, "title",        1, 1);
-      requiresField(publication, "author",       1, 1);
-      requiresField(publication, "year",         1, 1);
-      requiresField(publication, "isbn",         0, 1);
-      requiresField(publication, "issn",         0, 1);
-      requiresField(publication, "doi",          0, 1);
-      requiresField(publication, "url",          0, 1);
-      requiresField(publication, "url.size",     0, 1);
-      requiresField(publication, "url.mime",     0, 1);
-      requiresField(publication, "url.md5",      0, 1);
-      requiresField(publication, "url.checked",  0, 1);
-      requiresField(publication, "urn",          0, 1);
-      requiresField(publication, "pages",        0, 1);
-      requiresField(publication, "numpages",     0, 1);
-      requiresField(publication, "day",          0, 1);
-      requiresField(publication, "month",        0, 1);
-      requiresField(publication, "address",      0, 1);
-      requiresField(publication, "location",     0, 1);
-      requiresField(publication, "note",         0, 1);
-      requiresField(publication, "howpublished", 0, 1);
-      requiresField(publication, "publisher",    0, 1);
-      requiresField(publication, "school",       0, 1);
-      requiresField(publication, "institution",  0, 1);
-      requiresField(publication, "type",         0, 1);
-      requiresField(publication, "number",       0, 1);
-      requiresField(publication, "issue",        0, 1);
-      requiresField(publication, "volume",       0, 1);
-      requiresField(publication, "abstract",     0, 1);
-      requiresField(publication, "keywords",     0, 1);
-      if(publication->value == "Article") {
-         requiresField(publication, "journal", 1, 1);
-      }
-      else if(publication->value == "Book") {
-         requiresField(publication, "publisher", 1, 1);
-      }
-      else if(publication->value == "InProceedings") {
-         requiresField(publication, "booktitle", 1, 1);
-      }
-      else if(publication->value == "TechReport") {
-         requiresField(publication, "institution", 1, 1);
-      }
-      else if(publication->value == "Online") {
-         requiresField(publication, "url", 1, 1);
-      }
-
-      Node* author = findChildNode(publication, "author");
-      if(author != nullptr) {
-         unifyAuthor(publication, author);
-      }
-      else {
-         fprintf(stderr, "WARNING: Entry %s has no \"author\" section!\n" , label);
-      }
-
-      Node* booktitle = findChildNode(publication, "booktitle");
-      if(booktitle != nullptr) {
-         unifyBookTitle(publication, booktitle);
-      }
-      Node* howPublished = findChildNode(publication, "howPublished");
-      if(howPublished != nullptr) {
-         unifyBookTitle(publication, howPublished);
-      }
-      Node* journal = findChildNode(publication, "journal");
-      if(journal != nullptr) {
-         unifyBookTitle(publication, journal);   // Same as for booktitle!
-      }
-      Node* pages = findChildNode(publication, "pages");
-      if(pages != nullptr) {
-         unifyPages(publication, pages);
-      }
-      Node* numpages = findChildNode(publication, "numpages");
-      if(numpages != nullptr) {
-         unifyNumPages(publication, numpages);
-      }
-
-      Node* isbn = findChildNode(publication, "isbn");
-      if(isbn != nullptr) {
-         unifyISBN(publication, isbn);
-      }
-      Node* issn = findChildNode(publication, "issn");
-      if(issn != nullptr) {
-         unifyISSN(publication, issn);
-      }
-
-      Node* year  = findChildNode(publication, "year");
-      Node* month = findChildNode(publication, "month");
-      Node* day   = findChildNode(publication, "day");
-      if( (year != nullptr) || (month != nullptr) || (day != nullptr) ) {
-         unifyDate(publication, year, month, day);
-      }
-
-      Node* url = findChildNode(publication, "url");
-      if(url != nullptr) {
-         unifyURL(publication, url);
-      }
-   }
+   // NOTE: Sorting, unification and validation of the entry are done
+   //       after parsing, by unifyPublications(), or on first use of the
+   //       entry by unifyPublication() (lazy unification)!
 
    return publication;
 }
@@ -626,12 +524,18 @@ Node* makePublicationInfoItem(const char* keyword, const char* value)
       else if(node->keyword == "url.keywords") {
          node->priority = 192;
       }
-      else if(node->keyword == "file") {
+      else if(node->keyword == "url.etag") {
          node->priority = 191;
       }
-      else if(node->keyword == "repository") {
+      else if(node->keyword == "url.lastmodified") {
          node->priority = 190;
       }
+      else if(node->keyword == "file") {
+         node->priority = 189;
+      }
+      else if(node->keyword == "repository") {
+         node->priority = 188;
+      }
 
       // ====== Versioning ==================================================
       else if(node->keyword == "version") {
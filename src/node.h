@@ -41,16 +41,18 @@ extern int  yylex();
 #define NODE_CUSTOM_ENTRIES 9
 
 struct Node {
-   struct Node*             prev;
-   struct Node*             next;
-   struct Node*             child;
-   std::string              keyword;
-   std::string              value;
-   std::string              anchor;
-   std::string              custom[NODE_CUSTOM_ENTRIES];
-   std::vector<std::string> arguments;
-   unsigned int             priority;
-   int                      number;
+   struct Node*              prev;
+   struct Node*              next;
+   struct Node*              child;
+   std::string               keyword;
+   std::string               value;
+   std::string               anchor;
+   std::string               custom[NODE_CUSTOM_ENTRIES];
+   std::vector<unsigned int> authorIDs;   // Author IDs (see getAuthorName())
+   unsigned int              priority;
+   int                       number;
+   bool                      unified;
+   bool                      urlChecked;  // URL checked in this run
 };
 
 void freeNode(struct Node* node);
@@ -61,6 +63,7 @@ size_t countChildNodes(const Node* node, const char* childKeyword);
 Node* findNode(Node* node, const char* keyword);
 Node* findChildNode(Node* node, const char* childKeyword);
 Node* addOrUpdateChildNode(Node* node, const char* childKeyword, const char* value);
+void sortChildren(Node* node);
 
 struct Node* makePublicationCollection(struct Node* node1, struct Node* node2);
 struct Node* makePublication(const char* type, const char* label,
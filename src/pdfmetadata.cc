@@ -0,0 +1,1092 @@
+// ==========================================================================
+//                ____  _ _   _____   __  ______
+//                | __ )(_) |_|_   _|__\ \/ / ___|___  _ ____   __
+//                |  _ \| | '_ \| |/ _ \  / |   / _ \| '_ \ \ / /
+//                | |_) | | |_) | |  __//  \ |__| (_) | | | \ V /
+//                |____/|_|_.__/|_|\___/_/\_\____\___/|_| |_|\_/
+//
+//                          ---  BibTeX Converter  ---
+//                   https://www.nntb.no/~dreibh/bibtexconv/
+// ==========================================================================
+//
+// BibTeX Converter
+// Copyright (C) 2010-2026 by Thomas Dreibholz
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Contact: thomas.dreibholz@gmail.com
+
+#include "pdfmetadata.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#include <map>
+#include <set>
+#include <vector>
+
+
+// This is a minimal PDF reader, which only understands what is necessary to
+// obtain the number of pages, the keywords and the size of the first page:
+// cross-reference tables and streams, object streams and FlateDecode.
+// Anything else (e.g. encrypted documents) is left to "pdfinfo".
+
+// ###### PDF object ########################################################
+struct PDFObject
+{
+   enum PDFObjectType {
+      PDFNull, PDFBoolean, PDFNumber, PDFString, PDFName, PDFArray,
+      PDFDictionary, PDFReference
+   };
+
+   PDFObjectType            Type         = PDFNull;
+   double                   Number       = 0.0;     // Also reference number
+   std::string              Value;                  // String or name
+   std::vector<std::string> Keys;                   // Dictionary keys
+   std::vector<PDFObject>   Elements;               // Array/dictionary values
+   bool                     IsStream     = false;
+   size_t                   StreamOffset = 0;       // Stream data in file
+
+   const PDFObject* get(const char* key) const {
+      if(Type == PDFDictionary) {
+         for(size_t i = 0; i < Keys.size(); i++) {
+            if(Keys[i] == key) {
+               return &Elements[i];
+            }
+         }
+      }
+      return nullptr;
+   }
+   bool isName(const char* name) const {
+      return ( (Type == PDFName) && (Value == name) );
+   }
+};
+
+
+class PDFReader
+{
+   public:
+   PDFReader(const char* data, const size_t length);
+   bool read(PDFMetadata& metadata);
+
+   private:
+   struct XRefEntry {
+      unsigned int Type;     // 1: object in file; 2: object in object stream
+      uint64_t     Offset;   // File offset, or object stream number
+      unsigned int Index;    // Index in object stream
+   };
+   struct ObjectStream {
+      std::string                          Data;
+      std::map<unsigned int, unsigned int> Offsets;
+   };
+
+   static constexpr unsigned int MaxDepth        = 64;
+   static constexpr size_t       MaxDecodedSize  = 64 * 1048576;
+
+   static inline bool isSpace(const char c) {
+      return ( (c == ' ') || (c == '\n') || (c == '\r') ||
+               (c == '\t') || (c == '\f') || (c == 0x00) );
+   }
+   static inline bool isDelimiter(const char c) {
+      return (strchr("()<>[]{}/%", c) != nullptr);
+   }
+   static inline int hexValue(const char c) {
+      if( (c >= '0') && (c <= '9') ) return c - '0';
+      if( (c >= 'a') && (c <= 'f') ) return c - 'a' + 10;
+      if( (c >= 'A') && (c <= 'F') ) return c - 'A' + 10;
+      return -1;
+   }
+
+   static void skipSpace(const char* data, const size_t length, size_t& pos);
+   static bool hasKeyword(const char* data, const size_t length, size_t& pos,
+                          const char* keyword);
+   static bool parseUnsigned(const char* data, const size_t length, size_t& pos,
+                             uint64_t& value);
+   static bool parseObject(const char* data, const size_t length, size_t& pos,
+                           PDFObject& object, const unsigned int depth = 0);
+   static bool inflateData(const char* data, const size_t length,
+                           std::string& output);
+   static bool unpredict(std::string& data, const PDFObject* parameters);
+
+   bool getStreamData(const PDFObject& stream, std::string& output);
+   bool getObject(const unsigned int number, PDFObject& object,
+                  const unsigned int depth = 0);
+   bool resolve(const PDFObject& object, PDFObject& result,
+                const unsigned int depth = 0);
+   bool resolveEntry(const PDFObject& dictionary, const char* key,
+                     PDFObject& result);
+   bool getBox(const PDFObject& object, double* box);
+   bool readXRef();
+   bool readXRefSection(const size_t offset, PDFObject& trailer);
+   const ObjectStream* getObjectStream(const unsigned int number);
+
+   const char*                          Data;
+   const size_t                         Length;
+   std::map<unsigned int, XRefEntry>    XRef;
+   std::map<unsigned int, ObjectStream> ObjectStreamCache;
+   std::set<unsigned int>               ObjectStreamsInProgress;
+   PDFObject                            Trailer;
+};
+
+
+// ###### Constructor #######################################################
+PDFReader::PDFReader(const char* data, const size_t length)
+   : Data(data),
+     Length(length)
+{
+}
+
+
+// ###### Skip white space and comments #####################################
+void PDFReader::skipSpace(const char* data, const size_t length, size_t& pos)
+{
+   while(pos < length) {
+      if(isSpace(data[pos])) {
+         pos++;
+      }
+      else if(data[pos] == '%') {
+         while( (pos < length) && (data[pos] != '\n') && (data[pos] != '\r') ) {
+            pos++;
+         }
+      }
+      else {
+         break;
+      }
+   }
+}
+
+
+// ###### Check for keyword and skip it #####################################
+bool PDFReader::hasKeyword(const char* data, const size_t length, size_t& pos,
+                           const char* keyword)
+{
+   skipSpace(data, length, pos);
+   const size_t keywordLength = strlen(keyword);
+   if( (pos + keywordLength <= length) &&
+       (memcmp(&data[pos], keyword, keywordLength) == 0) &&
+       ( (pos + keywordLength == length) ||
+         (isSpace(data[pos + keywordLength])) ||
+         (isDelimiter(data[pos + keywordLength])) ) ) {
+      pos += keywordLength;
+      return true;
+   }
+   return false;
+}
+
+
+// ###### Parse unsigned integer ############################################
+bool PDFReader::parseUnsigned(const char* data, const size_t length, size_t& pos,
+                              uint64_t& value)
+{
+   skipSpace(data, length, pos);
+   if( (pos >= length) || (data[pos] < '0') || (data[pos] > '9') ) {
+      return false;
+   }
+   value = 0;
+   while( (pos < length) && (data[pos] >= '0') && (data[pos] <= '9') ) {
+      if(value < 0xffffffffffffULL) {
+         value = (10 * value) + (data[pos] - '0');
+      }
+      pos++;
+   }
+   return true;
+}
+
+
+// ###### Parse object ######################################################
+bool PDFReader::parseObject(const char* data, const size_t length, size_t& pos,
+                            PDFObject& object, const unsigned int depth)
+{
+   skipSpace(data, length, pos);
+   if( (pos >= length) || (depth > MaxDepth) ) {
+      return false;
+   }
+   object = PDFObject();
+
+   const char c = data[pos];
+   // ====== Name ===========================================================
+   if(c == '/') {
+      object.Type = PDFObject::PDFName;
+      pos++;
+      while( (pos < length) && (!isSpace(data[pos])) && (!isDelimiter(data[pos])) ) {
+         if( (data[pos] == '#') && (pos + 2 < length) &&
+             (hexValue(data[pos + 1]) >= 0) && (hexValue(data[pos + 2]) >= 0) ) {
+            object.Value += (char)((hexValue(data[pos + 1]) << 4) | hexValue(data[pos + 2]));
+            pos += 3;
+         }
+         else {
+            object.Value += data[pos++];
+         }
+      }
+      return true;
+   }
+
+   // ====== Literal string =================================================
+   else if(c == '(') {
+      object.Type = PDFObject::PDFString;
+      unsigned int level = 1;
+      pos++;
+      while(pos < length) {
+         char d = data[pos++];
+         if(d == '\\') {
+            if(pos >= length) {
+               return false;
+            }
+            d = data[pos++];
+            switch(d) {
+               case 'n': object.Value += '\n'; break;
+               case 'r': object.Value += '\r'; break;
+               case 't': object.Value += '\t'; break;
+               case 'b': object.Value += '\b'; break;
+               case 'f': object.Value += '\f'; break;
+               case '\r':
+                  if( (pos < length) && (data[pos] == '\n') ) {
+                     pos++;
+                  }
+                break;
+               case '\n':
+                break;
+               default:
+                  if( (d >= '0') && (d <= '7') ) {
+                     unsigned int value = d - '0';
+                     for(unsigned int i = 0; i < 2; i++) {
+                        if( (pos < length) && (data[pos] >= '0') && (data[pos] <= '7') ) {
+                           value = (value << 3) | (data[pos++] - '0');
+                        }
+                     }
+                     object.Value += (char)value;
+                  }
+                  else {
+                     object.Value += d;
+                  }
+                break;
+            }
+         }
+         else if(d == '(') {
+            level++;
+            object.Value += d;
+         }
+         else if(d == ')') {
+            if(--level == 0) {
+               return true;
+            }
+            object.Value += d;
+         }
+         else if(d == '\r') {
+            if( (pos < length) && (data[pos] == '\n') ) {
+               pos++;
+            }
+            object.Value += '\n';
+         }
+         else {
+            object.Value += d;
+         }
+      }
+      return false;
+   }
+
+   // ====== Dictionary (and stream) ========================================
+   else if( (c == '<') && (pos + 1 < length) && (data[pos + 1] == '<') ) {
+      object.Type = PDFObject::PDFDictionary;
+      pos += 2;
+      while(true) {
+         skipSpace(data, length, pos);
+         if(pos + 1 >= length) {
+            return false;
+         }
+         if( (data[pos] == '>') && (data[pos + 1] == '>') ) {
+            pos += 2;
+            break;
+         }
+         PDFObject key;
+         PDFObject value;
+         if( (!parseObject(data, length, pos, key, depth + 1)) ||
+             (key.Type != PDFObject::PDFName) ||
+             (!parseObject(data, length, pos, value, depth + 1)) ) {
+            return false;
+         }
+         object.Keys.push_back(key.Value);
+         object.Elements.push_back(value);
+      }
+
+      size_t streamPos = pos;
+      if(hasKeyword(data, length, streamPos, "stream")) {
+         if( (streamPos < length) && (data[streamPos] == '\r') ) {
+            streamPos++;
+         }
+         if( (streamPos < length) && (data[streamPos] == '\n') ) {
+            streamPos++;
+         }
+         object.IsStream     = true;
+         object.StreamOffset = streamPos;
+         pos = streamPos;
+      }
+      return true;
+   }
+
+   // ====== Hexadecimal string =============================================
+   else if(c == '<') {
+      object.Type = PDFObject::PDFString;
+      pos++;
+      int high = -1;
+      while( (pos < length) && (data[pos] != '>') ) {
+         const int value = hexValue(data[pos++]);
+         if(value >= 0) {
+            if(high < 0) {
+               high = value;
+            }
+            else {
+               object.Value += (char)((high << 4) | value);
+               high = -1;
+            }
+         }
+      }
+      if(high >= 0) {
+         object.Value += (char)(high << 4);
+      }
+      pos++;
+      return (pos <= length);
+   }
+
+   // ====== Array ==========================================================
+   else if(c == '[') {
+      object.Type = PDFObject::PDFArray;
+      pos++;
+      while(true) {
+         skipSpace(data, length, pos);
+         if(pos >= length) {
+            return false;
+         }
+         if(data[pos] == ']') {
+            pos++;
+            break;
+         }
+         PDFObject element;
+         if(!parseObject(data, length, pos, element, depth + 1)) {
+            return false;
+         }
+         object.Elements.push_back(element);
+      }
+      return true;
+   }
+
+   // ====== Number or reference ============================================
+   else if( ((c >= '0') && (c <= '9')) || (c == '+') || (c == '-') || (c == '.') ) {
+      char   number[64];
+      size_t n         = 0;
+      bool   isInteger = true;
+      while( (pos < length) && (n < sizeof(number) - 1) &&
+             ( ((data[pos] >= '0') && (data[pos] <= '9')) ||
+               (data[pos] == '+') || (data[pos] == '-') || (data[pos] == '.') ) ) {
+         if(data[pos] == '.') {
+            isInteger = false;
+         }
+         number[n++] = data[pos++];
+      }
+      number[n] = 0x00;
+      object.Type   = PDFObject::PDFNumber;
+      object.Number = atof(number);
+
+      // A non-negative integer may start a reference "<number> <generation> R":
+      if( (isInteger) && (c != '-') && (c != '+') ) {
+         size_t   referencePos = pos;
+         uint64_t generation;
+         if( (parseUnsigned(data, length, referencePos, generation)) &&
+             (hasKeyword(data, length, referencePos, "R")) ) {
+            object.Type = PDFObject::PDFReference;
+            pos = referencePos;
+         }
+      }
+      return true;
+   }
+
+   // ====== Keywords =======================================================
+   else if(hasKeyword(data, length, pos, "true")) {
+      object.Type   = PDFObject::PDFBoolean;
+      object.Number = 1.0;
+      return true;
+   }
+   else if(hasKeyword(data, length, pos, "false")) {
+      object.Type = PDFObject::PDFBoolean;
+      return true;
+   }
+   else if(hasKeyword(data, length, pos, "null")) {
+      return true;
+   }
+   return false;
+}
+
+
+// ###### Decompress FlateDecode data #######################################
+bool PDFReader::inflateData(const char* data, const size_t length,
+                            std::string& output)
+{
+   z_stream stream;
+   memset(&stream, 0, sizeof(stream));
+   if(inflateInit(&stream) != Z_OK) {
+      return false;
+   }
+   stream.next_in  = (Bytef*)data;
+   stream.avail_in = (uInt)length;
+
+   output.clear();
+   int result = Z_OK;
+   while(result == Z_OK) {
+      char buffer[65536];
+      stream.next_out  = (Bytef*)&buffer;
+      stream.avail_out = sizeof(buffer);
+      result = inflate(&stream, Z_NO_FLUSH);
+      if( (result == Z_OK) || (result == Z_STREAM_END) || (result == Z_BUF_ERROR) ) {
+         output.append(buffer, sizeof(buffer) - stream.avail_out);
+      }
+      if(output.size() > MaxDecodedSize) {
+         result = Z_MEM_ERROR;
+      }
+   }
+   inflateEnd(&stream);
+
+   // Some PDF writers produce slightly truncated streams. Accept the
+   // data as long as something could be decompressed.
+   return ( (result == Z_STREAM_END) ||
+            ((result == Z_BUF_ERROR) && (output.size() > 0)) );
+}
+
+
+// ###### Undo PNG predictor ################################################
+bool PDFReader::unpredict(std::string& data, const PDFObject* parameters)
+{
+   if( (parameters == nullptr) || (parameters->Type != PDFObject::PDFDictionary) ) {
+      return true;
+   }
+   const PDFObject* predictor = parameters->get("Predictor");
+   if( (predictor == nullptr) || (predictor->Type != PDFObject::PDFNumber) ||
+       (predictor->Number <= 1) ) {
+      return true;
+   }
+   if(predictor->Number < 10) {
+      return false;   // TIFF predictor is not supported
+   }
+
+   const PDFObject* columnsObject = parameters->get("Columns");
+   const PDFObject* colorsObject  = parameters->get("Colors");
+   const PDFObject* bitsObject    = parameters->get("BitsPerComponent");
+   const unsigned int columns = ((columnsObject != nullptr) && (columnsObject->Type == PDFObject::PDFNumber)) ?
+                                   (unsigned int)columnsObject->Number : 1;
+   const unsigned int colors  = ((colorsObject != nullptr) && (colorsObject->Type == PDFObject::PDFNumber)) ?
+                                   (unsigned int)colorsObject->Number : 1;
+   const unsigned int bits    = ((bitsObject != nullptr) && (bitsObject->Type == PDFObject::PDFNumber)) ?
+                                   (unsigned int)bitsObject->Number : 8;
+   const size_t rowLength     = ((size_t)columns * colors * bits + 7) / 8;
+   const size_t bytesPerPixel = std::max((size_t)1, ((size_t)colors * bits) / 8);
+   if( (rowLength == 0) || (rowLength > 65536) ) {
+      return false;
+   }
+
+   std::string        output;
+   std::vector<uint8_t> previous(rowLength, 0);
+   std::vector<uint8_t> row(rowLength);
+   for(size_t pos = 0; pos + 1 + rowLength <= data.size(); pos += 1 + rowLength) {
+      const uint8_t  type  = (uint8_t)data[pos];
+      const uint8_t* input = (const uint8_t*)&data[pos + 1];
+      for(size_t i = 0; i < rowLength; i++) {
+         const int left     = (i >= bytesPerPixel) ? row[i - bytesPerPixel] : 0;
+         const int up       = previous[i];
+         const int upLeft   = (i >= bytesPerPixel) ? previous[i - bytesPerPixel] : 0;
+         int       value    = input[i];
+         switch(type) {
+            case 0:
+             break;
+            case 1:
+               value += left;
+             break;
+            case 2:
+               value += up;
+             break;
+            case 3:
+               value += (left + up) / 2;
+             break;
+            case 4: {
+                  const int p  = left + up - upLeft;
+                  const int pa = abs(p - left);
+                  const int pb = abs(p - up);
+                  const int pc = abs(p - upLeft);
+                  value += ((pa <= pb) && (pa <= pc)) ? left : ((pb <= pc) ? up : upLeft);
+               }
+             break;
+            default:
+               return false;
+         }
+         row[i] = (uint8_t)value;
+      }
+      output.append((const char*)row.data(), rowLength);
+      previous.swap(row);
+   }
+   data.swap(output);
+   return true;
+}
+
+
+// ###### Get decoded data of a stream ######################################
+bool PDFReader::getStreamData(const PDFObject& stream, std::string& output)
+{
+   if( (!stream.IsStream) || (stream.StreamOffset > Length) ) {
+      return false;
+   }
+
+   // ====== Find the stream data ===========================================
+   size_t    length = 0;
+   PDFObject lengthObject;
+   if( (resolveEntry(stream, "Length", lengthObject)) &&
+       (lengthObject.Type == PDFObject::PDFNumber) &&
+       (lengthObject.Number >= 0) &&
+       (stream.StreamOffset + (size_t)lengthObject.Number <= Length) ) {
+      length = (size_t)lengthObject.Number;
+   }
+   else {
+      // The length is broken -> look for "endstream" instead.
+      const char* end = (const char*)memmem(&Data[stream.StreamOffset],
+                                            Length - stream.StreamOffset,
+                                            "endstream", 9);
+      if(end == nullptr) {
+         return false;
+      }
+      length = end - &Data[stream.StreamOffset];
+   }
+
+   // ====== Decode it ======================================================
+   const PDFObject* filter     = stream.get("Filter");
+   const PDFObject* parameters = stream.get("DecodeParms");
+   if( (filter != nullptr) && (filter->Type == PDFObject::PDFArray) ) {
+      if(filter->Elements.size() > 1) {
+         return false;
+      }
+      filter = (filter->Elements.size() == 1) ? &filter->Elements[0] : nullptr;
+   }
+   if( (parameters != nullptr) && (parameters->Type == PDFObject::PDFArray) ) {
+      parameters = (parameters->Elements.size() >= 1) ? &parameters->Elements[0] : nullptr;
+   }
+   if(filter == nullptr) {
+      output.assign(&Data[stream.StreamOffset], length);
+      return true;
+   }
+   else if(filter->isName("FlateDecode")) {
+      return ( (inflateData(&Data[stream.StreamOffset], length, output)) &&
+               (unpredict(output, parameters)) );
+   }
+   return false;
+}
+
+
+// ###### Get object stream #################################################
+const PDFReader::ObjectStream* PDFReader::getObjectStream(const unsigned int number)
+{
+   std::map<unsigned int, ObjectStream>::const_iterator found =
+      ObjectStreamCache.find(number);
+   if(found != ObjectStreamCache.end()) {
+      return &found->second;
+   }
+   if(!ObjectStreamsInProgress.insert(number).second) {
+      return nullptr;   // Loop!
+   }
+
+   PDFObject stream;
+   PDFObject first;
+   PDFObject count;
+   ObjectStream objectStream;
+   if( (!getObject(number, stream)) ||
+       (!stream.IsStream) ||
+       (!resolveEntry(stream, "First", first)) || (first.Type != PDFObject::PDFNumber) ||
+       (!resolveEntry(stream, "N", count))     || (count.Type != PDFObject::PDFNumber) ||
+       (!getStreamData(stream, objectStream.Data)) ) {
+      return nullptr;
+   }
+   size_t pos = 0;
+   for(unsigned int i = 0; i < (unsigned int)count.Number; i++) {
+      uint64_t objectNumber;
+      uint64_t offset;
+      if( (!parseUnsigned(objectStream.Data.data(), objectStream.Data.size(), pos, objectNumber)) ||
+          (!parseUnsigned(objectStream.Data.data(), objectStream.Data.size(), pos, offset)) ) {
+         break;
+      }
+      objectStream.Offsets.insert(std::pair<unsigned int, unsigned int>(
+         (unsigned int)objectNumber, (unsigned int)(first.Number + offset)));
+   }
+   return &(ObjectStreamCache[number] = objectStream);
+}
+
+
+// ###### Get indirect object ###############################################
+bool PDFReader::getObject(const unsigned int number, PDFObject& object,
+                          const unsigned int depth)
+{
+   std::map<unsigned int, XRefEntry>::const_iterator found = XRef.find(number);
+   if( (found == XRef.end()) || (depth > MaxDepth) ) {
+      return false;
+   }
+   const XRefEntry& entry = found->second;
+
+   // ====== Object in file =================================================
+   if(entry.Type == 1) {
+      size_t   pos = (size_t)entry.Offset;
+      uint64_t objectNumber;
+      uint64_t generation;
+      if( (pos >= Length) ||
+          (!parseUnsigned(Data, Length, pos, objectNumber)) ||
+          (objectNumber != number) ||
+          (!parseUnsigned(Data, Length, pos, generation)) ||
+          (!hasKeyword(Data, Length, pos, "obj")) ) {
+         return false;
+      }
+      return parseObject(Data, Length, pos, object);
+   }
+
+   // ====== Object in object stream ========================================
+   const ObjectStream* objectStream = getObjectStream((unsigned int)entry.Offset);
+   if(objectStream != nullptr) {
+      std::map<unsigned int, unsigned int>::const_iterator offset =
+         objectStream->Offsets.find(number);
+      if(offset != objectStream->Offsets.end()) {
+         size_t pos = offset->second;
+         if( (parseObject(objectStream->Data.data(), objectStream->Data.size(),
+                          pos, object)) &&
+             (!object.IsStream) ) {
+            return true;
+         }
+      }
+   }
+   return false;
+}
+
+
+// ###### Resolve reference #################################################
+bool PDFReader::resolve(const PDFObject& object, PDFObject& result,
+                        const unsigned int depth)
+{
+   if(object.Type != PDFObject::PDFReference) {
+      result = object;
+      return true;
+   }
+   PDFObject target;
+   if( (depth < MaxDepth) &&
+       (getObject((unsigned int)object.Number, target, depth)) ) {
+      return resolve(target, result, depth + 1);
+   }
+   return false;
+}
+
+
+// ###### Resolve dictionary entry ##########################################
+bool PDFReader::resolveEntry(const PDFObject& dictionary, const char* key,
+                             PDFObject& result)
+{
+   const PDFObject* entry = dictionary.get(key);
+   return ( (entry != nullptr) && (resolve(*entry, result)) );
+}
+
+
+// ###### Get rectangle #####################################################
+bool PDFReader::getBox(const PDFObject& object, double* box)
+{
+   if( (object.Type != PDFObject::PDFArray) || (object.Elements.size() != 4) ) {
+      return false;
+   }
+   for(unsigned int i = 0; i < 4; i++) {
+      PDFObject value;
+      if( (!resolve(object.Elements[i], value)) || (value.Type != PDFObject::PDFNumber) ) {
+         return false;
+      }
+      box[i] = value.Number;
+   }
+   if(box[0] > box[2]) {
+      std::swap(box[0], box[2]);
+   }
+   if(box[1] > box[3]) {
+      std::swap(box[1], box[3]);
+   }
+   return true;
+}
+
+
+// ###### Read cross-reference table or stream ##############################
+bool PDFReader::readXRefSection(const size_t offset, PDFObject& trailer)
+{
+   size_t pos = offset;
+   if(pos >= Length) {
+      return false;
+   }
+
+   // ====== Cross-reference table ==========================================
+   if(hasKeyword(Data, Length, pos, "xref")) {
+      while(!hasKeyword(Data, Length, pos, "trailer")) {
+         uint64_t start;
+         uint64_t count;
+         if( (!parseUnsigned(Data, Length, pos, start)) ||
+             (!parseUnsigned(Data, Length, pos, count)) ) {
+            return false;
+         }
+         for(uint64_t i = 0; i < count; i++) {
+            uint64_t entryOffset;
+            uint64_t generation;
+            if( (!parseUnsigned(Data, Length, pos, entryOffset)) ||
+                (!parseUnsigned(Data, Length, pos, generation)) ) {
+               return false;
+            }
+            skipSpace(Data, Length, pos);
+            if(pos >= Length) {
+               return false;
+            }
+            // Newer sections are read first, i.e. existing entries win.
+            if(Data[pos++] == 'n') {
+               const XRefEntry entry = { 1, entryOffset, 0 };
+               XRef.insert(std::pair<unsigned int, XRefEntry>((unsigned int)(start + i), entry));
+            }
+         }
+      }
+      return ( (parseObject(Data, Length, pos, trailer)) &&
+               (trailer.Type == PDFObject::PDFDictionary) );
+   }
+
+   // ====== Cross-reference stream =========================================
+   uint64_t    objectNumber;
+   uint64_t    generation;
+   std::string data;
+   PDFObject   w;
+   PDFObject   size;
+   PDFObject   index;
+   if( (!parseUnsigned(Data, Length, pos, objectNumber)) ||
+       (!parseUnsigned(Data, Length, pos, generation)) ||
+       (!hasKeyword(Data, Length, pos, "obj")) ||
+       (!parseObject(Data, Length, pos, trailer)) ||
+       (!trailer.IsStream) ||
+       (trailer.get("Type") == nullptr) || (!trailer.get("Type")->isName("XRef")) ||
+       (!resolveEntry(trailer, "W", w)) || (w.Type != PDFObject::PDFArray) ||
+       (w.Elements.size() != 3) ||
+       (!resolveEntry(trailer, "Size", size)) || (size.Type != PDFObject::PDFNumber) ||
+       (!getStreamData(trailer, data)) ) {
+      return false;
+   }
+   unsigned int fieldSize[3];
+   for(unsigned int i = 0; i < 3; i++) {
+      if( (w.Elements[i].Type != PDFObject::PDFNumber) ||
+          (w.Elements[i].Number < 0) || (w.Elements[i].Number > 8) ) {
+         return false;
+      }
+      fieldSize[i] = (unsigned int)w.Elements[i].Number;
+   }
+   const size_t entrySize = fieldSize[0] + fieldSize[1] + fieldSize[2];
+   if(entrySize == 0) {
+      return false;
+   }
+
+   std::vector<uint64_t> subsections;
+   if( (resolveEntry(trailer, "Index", index)) && (index.Type == PDFObject::PDFArray) ) {
+      for(const PDFObject& element : index.Elements) {
+         if(element.Type != PDFObject::PDFNumber) {
+            return false;
+         }
+         subsections.push_back((uint64_t)element.Number);
+      }
+   }
+   else {
+      subsections.push_back(0);
+      subsections.push_back((uint64_t)size.Number);
+   }
+
+   size_t dataPos = 0;
+   for(size_t s = 0; s + 1 < subsections.size(); s += 2) {
+      for(uint64_t i = 0; i < subsections[s + 1]; i++) {
+         if(dataPos + entrySize > data.size()) {
+            return true;   // Truncated: use what is there
+         }
+         uint64_t field[3] = { 1, 0, 0 };   // Default type is 1
+         for(unsigned int f = 0; f < 3; f++) {
+            if(fieldSize[f] > 0) {
+               field[f] = 0;
+               for(unsigned int b = 0; b < fieldSize[f]; b++) {
+                  field[f] = (field[f] << 8) | (uint8_t)data[dataPos++];
+               }
+            }
+         }
+         if( (field[0] == 1) || (field[0] == 2) ) {
+            const XRefEntry entry = { (unsigned int)field[0], field[1],
+                                      (unsigned int)field[2] };
+            XRef.insert(std::pair<unsigned int, XRefEntry>((unsigned int)(subsections[s] + i), entry));
+         }
+      }
+   }
+   return true;
+}
+
+
+// ###### Read all cross-reference sections #################################
+bool PDFReader::readXRef()
+{
+   // ====== Find "startxref" at the end of the file ========================
+   const size_t searchStart = (Length > 2048) ? Length - 2048 : 0;
+   size_t       pos         = Length;
+   for(size_t i = Length; i > searchStart; i--) {
+      if( (i - 1 + 9 <= Length) && (memcmp(&Data[i - 1], "startxref", 9) == 0) ) {
+         pos = i - 1 + 9;
+         break;
+      }
+   }
+   uint64_t offset;
+   if(!parseUnsigned(Data, Length, pos, offset)) {
+      return false;
+   }
+
+   // ====== Read the sections, from newest to oldest =======================
+   std::set<uint64_t> visited;
+   bool               first = true;
+   while( (offset < Length) && (visited.insert(offset).second) ) {
+      PDFObject trailer;
+      if(!readXRefSection((size_t)offset, trailer)) {
+         break;
+      }
+      if(first) {
+         Trailer = trailer;
+         first   = false;
+      }
+
+      // Hybrid files have an additional cross-reference stream:
+      const PDFObject* xrefStream = trailer.get("XRefStm");
+      if( (xrefStream != nullptr) && (xrefStream->Type == PDFObject::PDFNumber) &&
+          (visited.insert((uint64_t)xrefStream->Number).second) ) {
+         PDFObject streamTrailer;
+         readXRefSection((size_t)xrefStream->Number, streamTrailer);
+      }
+
+      const PDFObject* previous = trailer.get("Prev");
+      if( (previous == nullptr) || (previous->Type != PDFObject::PDFNumber) ||
+          (previous->Number < 0) ) {
+         break;
+      }
+      offset = (uint64_t)previous->Number;
+   }
+   return (!first);
+}
+
+
+// ###### Append Unicode character as UTF-8 #################################
+static void appendUTF8(std::string& string, const uint32_t c)
+{
+   if(c < 0x80) {
+      string += (char)c;
+   }
+   else if(c < 0x800) {
+      string += (char)(0xc0 | (c >> 6));
+      string += (char)(0x80 | (c & 0x3f));
+   }
+   else if(c < 0x10000) {
+      string += (char)(0xe0 | (c >> 12));
+      string += (char)(0x80 | ((c >> 6) & 0x3f));
+      string += (char)(0x80 | (c & 0x3f));
+   }
+   else {
+      string += (char)(0xf0 | (c >> 18));
+      string += (char)(0x80 | ((c >> 12) & 0x3f));
+      string += (char)(0x80 | ((c >> 6) & 0x3f));
+      string += (char)(0x80 | (c & 0x3f));
+   }
+}
+
+
+// ###### Convert PDF text string to UTF-8 ##################################
+static std::string textStringToUTF8(const std::string& string)
+{
+   // PDFDocEncoding characters 0x80 to 0xa0, which differ from ISO 8859-1:
+   static const uint16_t pdfDocEncoding[] = {
+      0x2022, 0x2020, 0x2021, 0x2026, 0x2014, 0x2013, 0x0192, 0x2044,
+      0x2039, 0x203a, 0x2212, 0x2030, 0x201e, 0x201c, 0x201d, 0x2018,
+      0x2019, 0x201a, 0x2122, 0xfb01, 0xfb02, 0x0141, 0x0152, 0x0160,
+      0x0178, 0x017d, 0x0131, 0x0142, 0x0153, 0x0161, 0x017e, 0xfffd,
+      0x20ac
+   };
+   std::string result;
+
+   // ====== UTF-16 =========================================================
+   if( (string.size() >= 2) &&
+       ( (((uint8_t)string[0] == 0xfe) && ((uint8_t)string[1] == 0xff)) ||
+         (((uint8_t)string[0] == 0xff) && ((uint8_t)string[1] == 0xfe)) ) ) {
+      const bool bigEndian = ((uint8_t)string[0] == 0xfe);
+      for(size_t i = 2; i + 1 < string.size(); i += 2) {
+         const uint8_t a = (uint8_t)string[i];
+         const uint8_t b = (uint8_t)string[i + 1];
+         uint32_t c = bigEndian ? ((a << 8) | b) : ((b << 8) | a);
+         if( (c >= 0xd800) && (c < 0xdc00) && (i + 3 < string.size()) ) {
+            const uint8_t  d = (uint8_t)string[i + 2];
+            const uint8_t  e = (uint8_t)string[i + 3];
+            const uint32_t low = bigEndian ? ((d << 8) | e) : ((e << 8) | d);
+            if( (low >= 0xdc00) && (low < 0xe000) ) {
+               c = 0x10000 + ((c - 0xd800) << 10) + (low - 0xdc00);
+               i += 2;
+            }
+         }
+         appendUTF8(result, c);
+      }
+   }
+
+   // ====== UTF-8 (PDF 2.0) ================================================
+   else if( (string.size() >= 3) &&
+            ((uint8_t)string[0] == 0xef) && ((uint8_t)string[1] == 0xbb) &&
+            ((uint8_t)string[2] == 0xbf) ) {
+      result = string.substr(3);
+   }
+
+   // ====== PDFDocEncoding =================================================
+   else {
+      for(const char c : string) {
+         const uint8_t value = (uint8_t)c;
+         if( (value >= 0x80) && (value <= 0xa0) ) {
+            appendUTF8(result, pdfDocEncoding[value - 0x80]);
+         }
+         else {
+            appendUTF8(result, value);
+         }
+      }
+   }
+   return result;
+}
+
+
+// ###### Get paper name, like pdfinfo ######################################
+static const char* getPaperName(const double width, const double height)
+{
+   static const char* isoNames[] = { "A0", "A1", "A2", "A3", "A4", "A5", "A6" };
+
+   if( ((fabs(width - 612) < 1) && (fabs(height - 792) < 1)) ||
+       ((fabs(width - 792) < 1) && (fabs(height - 612) < 1)) ) {
+      return "letter";
+   }
+   double isoHeight = sqrt(sqrt(2.0)) * 7200.0 / 2.54;
+   double isoWidth  = isoHeight / sqrt(2.0);
+   for(unsigned int i = 0; i <= 6; i++) {
+      if( ((fabs(width - isoWidth) < 1) && (fabs(height - isoHeight) < 1)) ||
+          ((fabs(width - isoHeight) < 1) && (fabs(height - isoWidth) < 1)) ) {
+         return isoNames[i];
+      }
+      isoHeight = isoWidth;
+      isoWidth  = isoWidth / sqrt(2.0);
+   }
+   return nullptr;
+}
+
+
+// ###### Read metadata #####################################################
+bool PDFReader::read(PDFMetadata& metadata)
+{
+   clearPDFMetadata(metadata);
+
+   // ====== Get document catalog ===========================================
+   PDFObject root;
+   PDFObject pages;
+   PDFObject count;
+   if( (!readXRef()) ||
+       (Trailer.get("Encrypt") != nullptr) ||
+       (!resolveEntry(Trailer, "Root", root)) || (root.Type != PDFObject::PDFDictionary) ||
+       (!resolveEntry(root, "Pages", pages))  || (pages.Type != PDFObject::PDFDictionary) ||
+       (!resolveEntry(pages, "Count", count)) || (count.Type != PDFObject::PDFNumber) ||
+       (count.Number < 0) ) {
+      return false;
+   }
+   metadata.HasPages = true;
+   metadata.Pages    = (unsigned int)count.Number;
+
+   // ====== Get keywords ===================================================
+   PDFObject info;
+   PDFObject keywords;
+   if( (resolveEntry(Trailer, "Info", info)) && (info.Type == PDFObject::PDFDictionary) &&
+       (resolveEntry(info, "Keywords", keywords)) && (keywords.Type == PDFObject::PDFString) ) {
+      metadata.HasKeywords = true;
+      metadata.Keywords    = textStringToUTF8(keywords.Value);
+   }
+
+   // ====== Get size of first page =========================================
+   // MediaBox and CropBox may be inherited from the page tree nodes.
+   double    mediaBox[4];
+   double    cropBox[4];
+   bool      hasMediaBox = false;
+   bool      hasCropBox  = false;
+   PDFObject node        = pages;
+   for(unsigned int depth = 0; depth < MaxDepth; depth++) {
+      PDFObject box;
+      if( (resolveEntry(node, "MediaBox", box)) && (getBox(box, mediaBox)) ) {
+         hasMediaBox = true;
+      }
+      if( (resolveEntry(node, "CropBox", box)) && (getBox(box, cropBox)) ) {
+         hasCropBox = true;
+      }
+      PDFObject kids;
+      if( (!resolveEntry(node, "Kids", kids)) || (kids.Type != PDFObject::PDFArray) ) {
+         break;   // Reached the page
+      }
+      PDFObject kid;
+      if( (kids.Elements.size() == 0) ||
+          (!resolve(kids.Elements[0], kid)) || (kid.Type != PDFObject::PDFDictionary) ) {
+         hasMediaBox = false;
+         break;
+      }
+      node = kid;
+   }
+   if( (hasMediaBox) && (metadata.Pages > 0) ) {
+      if(hasCropBox) {   // The crop box is clipped to the media box
+         cropBox[0] = std::max(cropBox[0], mediaBox[0]);
+         cropBox[1] = std::max(cropBox[1], mediaBox[1]);
+         cropBox[2] = std::min(cropBox[2], mediaBox[2]);
+         cropBox[3] = std::min(cropBox[3], mediaBox[3]);
+      }
+      const double* box    = ( (hasCropBox) &&
+                               (cropBox[2] > cropBox[0]) &&
+                               (cropBox[3] > cropBox[1]) ) ? cropBox : mediaBox;
+      const double  width  = box[2] - box[0];
+      const double  height = box[3] - box[1];
+      char          pageSize[128];
+      const char*   paperName = getPaperName(width, height);
+      if(paperName != nullptr) {
+         snprintf((char*)&pageSize, sizeof(pageSize), "%g x %g pts (%s)", width, height, paperName);
+      }
+      else {
+         snprintf((char*)&pageSize, sizeof(pageSize), "%g x %g pts", width, height);
+      }
+      metadata.HasPageSize = true;
+      metadata.PageSize    = pageSize;
+   }
+   return true;
+}
+
+
+// ###### Clear PDF metadata ################################################
+void clearPDFMetadata(PDFMetadata& metadata)
+{
+   metadata.HasPages    = false;
+   metadata.Pages       = 0;
+   metadata.HasKeywords = false;
+   metadata.Keywords.clear();
+   metadata.HasPageSize = false;
+   metadata.PageSize.clear();
+}
+
+
+// ###### Read PDF metadata from memory #####################################
+bool readPDFMetadata(const char*  data,
+                     const size_t length,
+                     PDFMetadata& metadata)
+{
+   PDFReader reader(data, length);
+   return reader.read(metadata);
+}
@@ -0,0 +1,52 @@
+// ==========================================================================
+//                ____  _ _   _____   __  ______
+//                | __ )(_) |_|_   _|__\ \/ / ___|___  _ ____   __
+//                |  _ \| | '_ \| |/ _ \  / |   / _ \| '_ \ \ / /
+//                | |_) | | |_) | |  __//  \ |__| (_) | | | \ V /
+//                |____/|_|_.__/|_|\___/_/\_\____\___/|_| |_|\_/
+//
+//                          ---  BibTeX Converter  ---
+//                   https://www.nntb.no/~dreibh/bibtexconv/
+// ==========================================================================
+//
+// BibTeX Converter
+// Copyright (C) 2010-2026 by Thomas Dreibholz
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Contact: thomas.dreibholz@gmail.com
+
+#ifndef PDFMETADATA_H
+#define PDFMETADATA_H
+
+#include <stddef.h>
+
+#include <string>
+
+
+struct PDFMetadata {
+   bool         HasPages;
+   unsigned int Pages;
+   bool         HasKeywords;
+   std::string  Keywords;      // UTF-8
+   bool         HasPageSize;
+   std::string  PageSize;      // Like pdfinfo: "595.276 x 841.89 pts (A4)"
+};
+
+void clearPDFMetadata(PDFMetadata& metadata);
+bool readPDFMetadata(const char*  data,
+                     const size_t length,
+                     PDFMetadata& metadata);
+
+#endif
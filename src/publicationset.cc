@@ -30,13 +30,18 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <math.h>
 
 #include <algorithm>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "publicationset.h"
+#include "batchwriter.h"
+#include "unification.h"
+#include "workerpool.h"
 
 
 // ###### Constructor #######################################################
@@ -79,6 +84,9 @@ bool PublicationSet::add(Node* publication)
    }
    publicationArray[entries] = publication;
    entries++;
+
+   // With lazy unification, the entry is unified on its first use:
+   unifyPublication(publication);
    return true;
 }
 
@@ -86,6 +94,9 @@ bool PublicationSet::add(Node* publication)
 // ###### Add all nodes from collection #####################################
 void PublicationSet::addAll(Node* publication)
 {
+   // With lazy unification, unify all remaining entries in parallel first:
+   unifyPublications(publication);
+
    while(publication != nullptr) {
       if(add(publication)) {
          publication->anchor = publication->keyword;
@@ -179,344 +190,692 @@ std::string PublicationSet::makeDownloadFileName(const char*        downloadDire
 }
 
 
-// ###### Export to BibTeX ##################################################
-bool PublicationSet::exportPublicationSetToBibTeX(PublicationSet* publicationSet,
-                                                  const char*     fileNamePrefix,
-                                                  const bool      separateFiles,
-                                                  const bool      skipNotesWithISBNandISSN,
-                                                  const bool      addNotesWithISBNandISSN,
-                                                  const bool      addUrlCommand)
+// ###### Fields used by the exporters ######################################
+// All fields needed by the exporters are resolved in one pass over the
+// children of a publication, instead of one findChildNode() walk per field.
+// As with findChildNode(), the first occurrence of a field is used.
+struct ExportFields
 {
-   FILE* fh = nullptr;
-   if(!separateFiles) {
-      fh = fopen(fileNamePrefix, "w");
-      if(fh == nullptr) {
-         fprintf(stderr, "ERROR: Unable to create BibTeX file %s!\n", fileNamePrefix);
-         return false;
+   const Node* title;
+   const Node* author;
+   const Node* year;
+   const Node* month;
+   const Node* day;
+   const Node* url;
+   const Node* urlMime;
+   const Node* urlSize;
+   const Node* type;
+   const Node* howpublished;
+   const Node* booktitle;
+   const Node* journal;
+   const Node* volume;
+   const Node* number;
+   const Node* pages;
+   const Node* isbn;
+   const Node* issn;
+   const Node* doi;
+   const Node* urlMD5;
+   const Node* editor;
+   const Node* series;
+   const Node* edition;
+   const Node* publisher;
+   const Node* institution;
+   const Node* school;
+   const Node* organization;
+   const Node* address;
+   const Node* language;
+   const Node* note;
+   const Node* abstract;
+};
+
+
+// ###### Resolve fields used by the exporters ##############################
+static void resolveExportFields(const Node* publication, ExportFields& fields)
+{
+   // Field table: keyword -> member of ExportFields
+   static const std::unordered_map<std::string, const Node* ExportFields::*> fieldTable = {
+      { "title",        &ExportFields::title        },
+      { "author",       &ExportFields::author       },
+      { "year",         &ExportFields::year         },
+      { "month",        &ExportFields::month        },
+      { "day",          &ExportFields::day          },
+      { "url",          &ExportFields::url          },
+      { "url.mime",     &ExportFields::urlMime      },
+      { "url.size",     &ExportFields::urlSize      },
+      { "type",         &ExportFields::type         },
+      { "howpublished", &ExportFields::howpublished },
+      { "booktitle",    &ExportFields::booktitle    },
+      { "journal",      &ExportFields::journal      },
+      { "volume",       &ExportFields::volume       },
+      { "number",       &ExportFields::number       },
+      { "pages",        &ExportFields::pages        },
+      { "isbn",         &ExportFields::isbn         },
+      { "issn",         &ExportFields::issn         },
+      { "doi",          &ExportFields::doi          },
+      { "url.md5",      &ExportFields::urlMD5       },
+      { "editor",       &ExportFields::editor       },
+      { "series",       &ExportFields::series       },
+      { "edition",      &ExportFields::edition      },
+      { "publisher",    &ExportFields::publisher    },
+      { "institution",  &ExportFields::institution  },
+      { "school",       &ExportFields::school       },
+      { "organization", &ExportFields::organization },
+      { "address",      &ExportFields::address      },
+      { "language",     &ExportFields::language     },
+      { "note",         &ExportFields::note         },
+      { "abstract",     &ExportFields::abstract     }
+   };
+
+   memset(&fields, 0, sizeof(fields));
+   for(const Node* child = publication->child; child != nullptr; child = child->next) {
+      const auto found = fieldTable.find(child->keyword);
+      if( (found != fieldTable.end()) && (fields.*(found->second) == nullptr) ) {
+         fields.*(found->second) = child;
       }
    }
+}
 
-   for(size_t index = 0; index < publicationSet->size(); index++) {
-      const Node* publication = publicationSet->get(index);
-      if(publication->value == "Comment") {
-         if(fh != nullptr) {
-            Node* child = publication->child;
-            if(child != nullptr) {
-               fprintf(fh, "%%%s\n\n", child->value.c_str());
-            }
+
+// ###### Render publication as BibTeX entry ################################
+static void renderBibTeX(std::string&       output,
+                         const Node*        publication,
+                         const ExportSinks& sinks)
+{
+   output += '@';
+   output += publication->value;
+   output += "{ ";
+   output += publication->keyword;
+   output += ",\n";
+
+   bool  empty           = true;
+   Node* child           = publication->child;
+   const Node* issn      = nullptr;
+   const Node* isbn      = nullptr;
+   const char* separator = "";
+   auto addItem = [&](const std::string& keyword,
+                      const char*        prefix,
+                      const std::string& value,
+                      const char*        suffix) {
+      output += separator;
+      output += '\t';
+      output += keyword;
+      output += " = ";
+      output += prefix;
+      output += value;
+      output += suffix;
+   };
+   while(child != nullptr) {
+      if(!empty) {
+         separator = ",\n";
+      }
+      empty = false;
+
+      if( (child->keyword == "title")     ||
+          (child->keyword == "booktitle") ||
+          (child->keyword == "series")    ||
+          (child->keyword == "journal")   ||
+          (child->keyword == "abstract") ) {
+         addItem(child->keyword, "\"{", child->value, "}\"");
+      }
+      else if( (child->keyword == "day") ||
+               (child->keyword == "year") ) {
+         addItem(child->keyword, "\"", std::to_string(child->number), "\"");
+      }
+      else if( (child->keyword == "month") ) {
+         static const std::string bibtexMonthNames[12] = {"jan", "feb", "mar", "apr", "may", "jun", "jul", "aug", "sep", "oct", "nov", "dec"};
+         if((child->number >= 1) && (child->number <= 12)) {
+            addItem(child->keyword, "", bibtexMonthNames[child->number - 1], "");
          }
       }
+      else if( (child->keyword == "url") ) {
+         if(sinks.addUrlCommand) {
+            addItem(child->keyword, "\"\\url{", urlToLaTeX(child->value), "}\"");
+         }
+         else {
+            addItem(child->keyword, "\"", urlToLaTeX(child->value), "\"");
+         }
+      }
+      else if( (child->keyword == "doi") ) {
+         addItem(child->keyword, "\"", urlToLaTeX(child->value), "\"");
+      }
+      else if( (child->keyword == "note") ) {
+         if( (sinks.skipNotesWithISBNandISSN == false) ||
+             ((strncmp(child->value.c_str(), "ISBN", 4) != 0) &&
+              (strncmp(child->value.c_str(), "ISSN", 4) != 0) &&
+              (strncmp(child->value.c_str(), "{ISBN}", 6) != 0) &&
+              (strncmp(child->value.c_str(), "{ISSN}", 6) != 0)) ) {
+            addItem(child->keyword, "\"", child->value, "\"");
+         }
+      }
+      else if( (child->keyword == "removeme") ) {
+         // Skip this entry. Useful for combining BibTeXConv with "sed" filtering.
+      }
       else {
-         if(separateFiles) {
-            char fileName[1024];
-            snprintf((char*)&fileName, sizeof(fileName), "%s%s.bib", fileNamePrefix, publication->keyword.c_str());
-            fh = fopen(fileName, "w");
-            if(fh == nullptr) {
-               fprintf(stderr, "ERROR: Unable to create XML file %s!\n", fileName);
-               return false;
-            }
+         if(child->keyword == "isbn") {
+            isbn = child;
          }
+         else if(child->keyword == "issn") {
+            issn = child;
+         }
+         addItem(child->keyword, "\"", child->value, "\"");
+      }
+      child = child->next;
+   }
 
-         fprintf(fh, "@%s{ %s,\n", publication->value.c_str(),
-                                   publication->keyword.c_str());
+   if( (sinks.addNotesWithISBNandISSN) &&
+       ((isbn != nullptr) || (issn != nullptr)) ) {
+      static const std::string note = "note";
+      if(isbn) {
+         addItem(note, "\"{ISBN} ", isbn->value, "\"");
+      }
+      else if(issn) {
+         addItem(note, "\"{ISSN} ", issn->value, "\"");
+      }
+   }
 
-         bool  empty           = true;
-         Node* child           = publication->child;
-         const Node* issn      = nullptr;
-         const Node* isbn      = nullptr;
-         const char* separator = "";
-         while(child != nullptr) {
-            if(!empty) {
-               separator = ",\n";
-            }
-            empty = false;
-
-            if( (child->keyword == "title")     ||
-                (child->keyword == "booktitle") ||
-                (child->keyword == "series")    ||
-                (child->keyword == "journal")   ||
-                (child->keyword == "abstract") ) {
-               fprintf(fh, "%s\t%s = \"{%s}\"", separator, child->keyword.c_str(), child->value.c_str());
-            }
-            else if( (child->keyword == "day") ||
-                     (child->keyword == "year") ) {
-               fprintf(fh, "%s\t%s = \"%u\"", separator, child->keyword.c_str(), child->number);
-            }
-            else if( (child->keyword == "month") ) {
-               static const char* bibtexMonthNames[12] = {"jan", "feb", "mar", "apr", "may", "jun", "jul", "aug", "sep", "oct", "nov", "dec"};
-               if((child->number >= 1) && (child->number <= 12)) {
-                  fprintf(fh, "%s\t%s = %s", separator, child->keyword.c_str(), bibtexMonthNames[child->number - 1]);
-               }
-            }
-            else if( (child->keyword == "url") ) {
-               if(addUrlCommand) {
-                  fprintf(fh, "%s\t%s = \"\\url{%s}\"", separator, child->keyword.c_str(), urlToLaTeX(child->value).c_str());
-               }
-               else {
-                  fprintf(fh, "%s\t%s = \"%s\"", separator, child->keyword.c_str(), urlToLaTeX(child->value).c_str());
-               }
-            }
-            else if( (child->keyword == "doi") ) {
-               fprintf(fh, "%s\t%s = \"%s\"", separator, child->keyword.c_str(), urlToLaTeX(child->value).c_str());
-            }
-            else if( (child->keyword == "note") ) {
-               if( (skipNotesWithISBNandISSN == false) ||
-                   ((strncmp(child->value.c_str(), "ISBN", 4) != 0) &&
-                    (strncmp(child->value.c_str(), "ISSN", 4) != 0) &&
-                    (strncmp(child->value.c_str(), "{ISBN}", 6) != 0) &&
-                    (strncmp(child->value.c_str(), "{ISSN}", 6) != 0)) ) {
-                  fprintf(fh, "%s\t%s = \"%s\"", separator, child->keyword.c_str(), child->value.c_str());
-               }
-            }
-            else if( (child->keyword == "removeme") ) {
-               // Skip this entry. Useful for combining BibTeXConv with "sed" filtering.
-            }
-            else {
-               if(child->keyword == "isbn") {
-                  isbn = child;
-               }
-               else if(child->keyword == "issn") {
-                  issn = child;
-               }
-               fprintf(fh, "%s\t%s = \"%s\"", separator, child->keyword.c_str(), child->value.c_str());
-            }
-            child = child->next;
-         }
+   output += "\n}\n\n";
+}
 
-         if( (addNotesWithISBNandISSN) &&
-             ((isbn != nullptr) || (issn != nullptr)) ) {
-            if(isbn) {
-               fprintf(fh, "%s\tnote = \"{ISBN} %s\"", separator, isbn->value.c_str());
-            }
-            else if(issn) {
-               fprintf(fh, "%s\tnote = \"{ISSN} %s\"", separator, issn->value.c_str());
-            }
-         }
 
-         fputs("\n}\n\n", fh);
+// ###### Render publication as XML reference ###############################
+// The output is appended piece by piece to the entry's buffer, without
+// building temporary strings (except for the escaping).
+static void renderXML(std::string&        output,
+                      const Node*         publication,
+                      const ExportFields& fields)
+{
+   static const std::string noValue;
+
+   output += "<reference anchor=\"";
+   output += labelToXMLLabel(publication->keyword);
+   output += '"';
+   if(fields.url != nullptr) {
+      output += " target=\"";
+      output += fields.url->value;
+      output += '"';
+   }
+   output += ">\n\t<front>\n";
+   if(fields.title) {
+      output += "\t\t<title>";
+      output += string2xml(fields.title->value);
+      output += "</title>\n";
+   }
+   if(fields.author) {
+      for(const unsigned int authorID : fields.author->authorIDs) {
+         const AuthorName* name = getAuthorName(authorID);
+         std::string familyName = name->familyName;
+         std::string givenName  = name->givenName;
+         std::string initials   = name->initials;
+         removeBrackets(familyName);
+         removeBrackets(givenName);
+         removeBrackets(initials);
+         output += "\t\t<author initials=\"";
+         output += string2xml(initials);
+         output += "\" surname=\"";
+         output += string2xml(familyName);
+         output += "\" fullname=\"";
+         if(givenName != "") {
+            givenName += "~";
+         }
+         output += string2xml(givenName + familyName);
+         output += "\" />\n";
       }
-
-      if( (separateFiles) && (fh != nullptr)) {
-         fclose(fh);
-         fh = nullptr;
+   }
+   if(fields.year || fields.month || fields.day) {
+      output += "\t\t<date ";
+      if(fields.day) {
+         output += "day=\"";
+         output += std::to_string(fields.day->number);
+         output += "\" ";
       }
+      if(fields.month) {
+         static const char* xmlMonthNames[12] = {"January", "February", "March", "April", "May", "June", "July", "August", "September", "October", "November", "December"};
+         if((fields.month->number >= 1) && (fields.month->number <= 12)) {
+            output += "month=\"";
+            output += xmlMonthNames[fields.month->number - 1];
+            output += "\" ";
+         }
+      }
+      if(fields.year) {
+         output += "year=\"";
+         output += std::to_string(fields.year->number);
+         output += "\" ";
+      }
+      output += "/>\n";
+   }
+   output += "\t</front>\n";
+
+   // ====== Series information =============================================
+   // The series name is taken from type, journal, booktitle or howpublished
+   // (in this order of priority). The value lists the numbering items.
+   const Node* series = (fields.type != nullptr)      ? fields.type :
+                        (fields.journal != nullptr)   ? fields.journal :
+                        (fields.booktitle != nullptr) ? fields.booktitle :
+                                                        fields.howpublished;
+   const std::string& seriesName = (series != nullptr) ? series->value : noValue;
+   std::string        seriesValue;
+   auto addSeriesItem = [&](const char* label, const Node* item) {
+      if(item != nullptr) {
+         if(!seriesValue.empty()) {
+            seriesValue += ", ";
+         }
+         seriesValue += label;
+         seriesValue += item->value;
+      }
+   };
+   // With a type (e.g. "RFC"), the number is just appended to it:
+   addSeriesItem((fields.type != nullptr) ? "" : "Number ", fields.number);
+   addSeriesItem("Volume ", fields.volume);
+   addSeriesItem("Pages ",  fields.pages);
+   addSeriesItem("ISSN~",   fields.issn);
+   addSeriesItem("ISBN~",   fields.isbn);
+   addSeriesItem("DOI~",    fields.doi);
+   if( (!seriesName.empty()) || (!seriesValue.empty()) ) {
+      output += "\t<seriesInfo name=\"";
+      if(seriesValue.empty()) {
+         // Just a name would produce an ugly space -> use it as value.
+         output += "\" value=\"";
+         output += string2xml(seriesName);
+      }
+      else {
+         output += string2xml(seriesName);
+         output += "\" value=\"";
+         output += string2xml(seriesValue);
+      }
+      output += "\" />\n";
    }
 
-   if(!separateFiles) {
-      fclose(fh);
+   // ====== Format ==========================================================
+   if(fields.url) {
+      output += "\t<format type=\"";
+      if(fields.urlMime) {
+         const std::string& mime  = fields.urlMime->value;
+         const size_t       slash = mime.find("/");
+         if(slash != std::string::npos) {
+            std::string type = mime.substr(slash + 1);
+            std::transform(type.begin(), type.end(), type.begin(),
+                           (int(*)(int))std::toupper);
+            output += (type == "PLAIN") ? "TXT" : type;
+         }
+      }
+      output += '"';
+      if(fields.urlSize) {
+         output += " octets=\"";
+         output += std::to_string((unsigned int)atol(fields.urlSize->value.c_str()));
+         output += '"';
+      }
+      output += " target=\"";
+      output += fields.url->value;
+      output += "\" />\n";
    }
-   return true;
+   output += "</reference>\n\n";
 }
 
 
-// ###### Export to XML #####################################################
-bool PublicationSet::exportPublicationSetToXML(PublicationSet* publicationSet,
-                                               const char*     fileNamePrefix,
-                                               const bool      separateFiles)
+// ###### Get CSL type for BibTeX class ####################################
+static const char* getCSLType(const std::string& bibTeXClass)
 {
-   FILE* fh = nullptr;
-   if(!separateFiles) {
-      fh = fopen(fileNamePrefix, "w");
-      if(fh == nullptr) {
-         fprintf(stderr, "ERROR: Unable to create XML file %s!\n", fileNamePrefix);
-         return false;
+   struct CSLTypeTableEntry {
+      const char* bibTeXClass;
+      const char* cslType;
+   };
+   static const CSLTypeTableEntry cslTypeTable[] = {
+      { "Article",       "article-journal"  },
+      { "Book",          "book"             },
+      { "Booklet",       "pamphlet"         },
+      { "InBook",        "chapter"          },
+      { "InCollection",  "chapter"          },
+      { "InProceedings", "paper-conference" },
+      { "Conference",    "paper-conference" },
+      { "Proceedings",   "book"             },
+      { "Manual",        "book"             },
+      { "MastersThesis", "thesis"           },
+      { "PhDThesis",     "thesis"           },
+      { "TechReport",    "report"           },
+      { "Unpublished",   "manuscript"       },
+      { "Online",        "webpage"          }
+   };
+   for(size_t i = 0; i < (sizeof(cslTypeTable) / sizeof(CSLTypeTableEntry)); i++) {
+      if(strcasecmp(cslTypeTable[i].bibTeXClass, bibTeXClass.c_str()) == 0) {
+         return cslTypeTable[i].cslType;
       }
-      fputs("<?xml version='1.0' encoding='UTF-8'?>\n", fh);
-      fputs("<!DOCTYPE rfc PUBLIC '-//IETF//DTD RFC 2629//EN' 'http://xml.resource.org/authoring/rfc2629.dtd'>\n", fh);
    }
+   return "document";
+}
 
-   for(size_t index = 0; index < publicationSet->size(); index++) {
-      Node* publication = publicationSet->get(index);
 
-      if(publication->value == "Comment") {
-         if(fh != nullptr) {
-            fprintf(fh, "<!-- %s -->\n\n", publication->keyword.c_str());
+// ###### Render publication as JSON record ################################
+// One CSL-JSON compatible object per line. Text fields are converted from
+// LaTeX to UTF-8 ("~" becomes a non-breaking space), the authors are taken
+// from the already split author names, and the date is numeric.
+static void renderJSON(std::string&        output,
+                       const Node*         publication,
+                       const ExportFields& fields,
+                       const ExportSinks&  sinks)
+{
+   static const std::string nbsp = "\xc2\xa0";   // U+00A0 in UTF-8
+
+   auto addString = [&](const char* name, const std::string& value) {
+      output += ",\"";
+      output += name;
+      output += "\":\"";
+      output += string2json(value);
+      output += '"';
+   };
+   auto addText = [&](const char* name, const Node* node) {
+      if(node != nullptr) {
+         addString(name, string2utf8(node->value, nbsp, "\n", false));
+      }
+   };
+   auto addValue = [&](const char* name, const Node* node) {
+      if(node != nullptr) {
+         addString(name, node->value);
+      }
+   };
+
+   output += "{\"id\":\"";
+   output += string2json(publication->keyword);
+   output += "\",\"type\":\"";
+   output += getCSLType(publication->value);
+   output += '"';
+   addText("title", fields.title);
+
+   // ====== Authors and editors ============================================
+   if(fields.author) {
+      output += ",\"author\":[";
+      for(size_t i = 0; i < fields.author->authorIDs.size(); i++) {
+         const AuthorName* name = getAuthorName(fields.author->authorIDs[i]);
+         std::string familyName = name->familyName;
+         std::string givenName  = name->givenName;
+         removeBrackets(familyName);
+         removeBrackets(givenName);
+         output += (i > 0) ? ",{\"family\":\"" : "{\"family\":\"";
+         output += string2json(string2utf8(familyName, nbsp, "\n", false));
+         output += '"';
+         if(!givenName.empty()) {
+            output += ",\"given\":\"";
+            output += string2json(string2utf8(givenName, nbsp, "\n", false));
+            output += '"';
+         }
+         output += '}';
+      }
+      output += ']';
+   }
+   if(fields.editor) {
+      // Editors are not unified, so they are given as literal names.
+      std::vector<std::string> editors;
+      splitString(editors, fields.editor->value, " and ");
+      output += ",\"editor\":[";
+      for(size_t i = 0; i < editors.size(); i++) {
+         output += (i > 0) ? ",{\"literal\":\"" : "{\"literal\":\"";
+         output += string2json(string2utf8(removeBrackets(trim(editors[i])), nbsp, "\n", false));
+         output += "\"}";
+      }
+      output += ']';
+   }
+
+   // ====== Date ===========================================================
+   if(fields.year) {
+      output += ",\"issued\":{\"date-parts\":[[";
+      output += std::to_string(fields.year->number);
+      if( (fields.month) && (fields.month->number >= 1) && (fields.month->number <= 12) ) {
+         output += ',';
+         output += std::to_string(fields.month->number);
+         if( (fields.day) && (fields.day->number >= 1) && (fields.day->number <= 31) ) {
+            output += ',';
+            output += std::to_string(fields.day->number);
          }
       }
+      output += "]]}";
+   }
+
+   // ====== Container, publisher and numbering =============================
+   addText("container-title",  (fields.journal != nullptr) ? fields.journal : fields.booktitle);
+   addText("collection-title", fields.series);
+   addText("publisher",        (fields.publisher   != nullptr) ? fields.publisher :
+                               (fields.institution != nullptr) ? fields.institution :
+                               (fields.school      != nullptr) ? fields.school :
+                                                                 fields.organization);
+   addText("publisher-place",  fields.address);
+   addValue("edition",         fields.edition);
+   addValue("volume",          fields.volume);
+   addValue((strcasecmp(publication->value.c_str(), "Article") == 0) ? "issue" : "number",
+            fields.number);
+   if(fields.pages) {
+      std::string pages = fields.pages->value;
+      replaceAll(pages, "--", "-");
+      addString("page", pages);
+   }
+   addValue("ISBN", fields.isbn);
+   addValue("ISSN", fields.issn);
+   addValue("DOI",  fields.doi);
+   addValue("URL",  fields.url);
+   if(fields.language) {
+      const char* language = getXMLLanguageFromLaTeX(fields.language->value.c_str());
+      addString("language", (language != nullptr) ? language : fields.language->value);
+   }
+   if( (fields.note) &&
+       ( (sinks.skipNotesWithISBNandISSN == false) ||
+         ((strncmp(fields.note->value.c_str(), "ISBN", 4) != 0) &&
+          (strncmp(fields.note->value.c_str(), "ISSN", 4) != 0) &&
+          (strncmp(fields.note->value.c_str(), "{ISBN}", 6) != 0) &&
+          (strncmp(fields.note->value.c_str(), "{ISSN}", 6) != 0)) ) ) {
+      addText("note", fields.note);
+   }
+   addText("abstract", fields.abstract);
+
+   // ====== Download information (not part of CSL) =========================
+   if(fields.urlMime || fields.urlSize || fields.urlMD5) {
+      output += ",\"custom\":{";
+      const size_t start = output.size();
+      if(fields.urlMime) {
+         output += "\"url.mime\":\"";
+         output += string2json(fields.urlMime->value);
+         output += '"';
+      }
+      if(fields.urlSize) {
+         output += (output.size() > start) ? ",\"url.size\":" : "\"url.size\":";
+         output += std::to_string(atoll(fields.urlSize->value.c_str()));
+      }
+      if(fields.urlMD5) {
+         output += (output.size() > start) ? ",\"url.md5\":\"" : "\"url.md5\":\"";
+         output += string2json(fields.urlMD5->value);
+         output += '"';
+      }
+      output += '}';
+   }
+   output += "}\n";
+}
+
+
+// ###### Export to BibTeX, XML and/or JSON sinks in one traversal #########
+// Each publication is visited once: its fields are resolved once, and it is
+// rendered for all requested formats. The rendering is done in parallel,
+// in blocks of publications; the output is written in the original order.
+// The separate files of a block are written as one batch by BatchWriter.
+bool PublicationSet::exportPublicationSet(PublicationSet*    publicationSet,
+                                          const ExportSinks& sinks)
+{
+   static const char* xmlHeader =
+      "<?xml version='1.0' encoding='UTF-8'?>\n"
+      "<!DOCTYPE rfc PUBLIC '-//IETF//DTD RFC 2629//EN' 'http://xml.resource.org/authoring/rfc2629.dtd'>\n";
+   const bool renderBibTeXs = (sinks.bibTeXFile != nullptr) || (sinks.separateBibTeXsPrefix != nullptr);
+   const bool renderXMLs    = (sinks.xmlFile != nullptr)    || (sinks.separateXMLsPrefix != nullptr);
+   const bool renderJSONs   = (sinks.jsonFile != nullptr);
+   if( (!renderBibTeXs) && (!renderXMLs) && (!renderJSONs) ) {
+      return true;   // Nothing to export.
+   }
+
+   // ====== Create the combined files ======================================
+   BatchWriter batchWriter(sinks.onlyWriteChangedFiles);
+   std::string bibTeXTemporaryFileName;
+   std::string xmlTemporaryFileName;
+   std::string jsonTemporaryFileName;
+   FILE*       bibTeXFH = nullptr;
+   FILE*       xmlFH    = nullptr;
+   FILE*       jsonFH   = nullptr;
+   bool        success  = true;
+   bool        aborted  = false;
+   if(sinks.bibTeXFile != nullptr) {
+      bibTeXFH = batchWriter.openCombinedFile(sinks.bibTeXFile, "BibTeX",
+                                              bibTeXTemporaryFileName);
+      if(bibTeXFH == nullptr) {
+         success = false;
+      }
+   }
+   if(sinks.xmlFile != nullptr) {
+      xmlFH = batchWriter.openCombinedFile(sinks.xmlFile, "XML",
+                                           xmlTemporaryFileName);
+      if(xmlFH == nullptr) {
+         success = false;
+      }
       else {
-         if(separateFiles) {
-            char fileName[1024];
-            snprintf((char*)&fileName, sizeof(fileName), "%s%s.xml", fileNamePrefix, publication->keyword.c_str());
-            fh = fopen(fileName, "w");
-            if(fh == nullptr) {
-               fprintf(stderr, "ERROR: Unable to create XML file %s!\n", fileName);
-               return false;
+         fputs(xmlHeader, xmlFH);
+      }
+   }
+   if(sinks.jsonFile != nullptr) {
+      jsonFH = batchWriter.openCombinedFile(sinks.jsonFile, "JSON",
+                                            jsonTemporaryFileName);
+      if(jsonFH == nullptr) {
+         success = false;
+      }
+   }
+
+   // ====== Render and write the publications block by block ===============
+   // A failing combined file does not stop the other outputs, but a failing
+   // separate file stops the export after the current block.
+   const size_t             blockSize = 256 * (size_t)getNumberOfWorkers();
+   std::vector<std::string> bibTeXs;
+   std::vector<std::string> xmls;
+   std::vector<std::string> jsons;
+   std::vector<OutputFile>  separateFiles;
+   for(size_t blockStart = 0;
+       (!aborted) && (blockStart < publicationSet->size());
+       blockStart += blockSize) {
+      const size_t blockEntries = std::min(blockSize, publicationSet->size() - blockStart);
+      bibTeXs.assign((renderBibTeXs) ? blockEntries : 0, std::string());
+      xmls.assign((renderXMLs) ? blockEntries : 0, std::string());
+      jsons.assign((renderJSONs) ? blockEntries : 0, std::string());
+
+      // ====== Render all formats of each publication in parallel ==========
+      runInParallel(blockEntries, [&](const size_t i) {
+         const Node* publication = publicationSet->get(blockStart + i);
+         if(publication->value == "Comment") {
+            if(renderBibTeXs) {
+               const Node* child = publication->child;
+               if(child != nullptr) {
+                  bibTeXs[i] = "%" + child->value + "\n\n";
+               }
             }
-            fputs("<?xml version='1.0' encoding='UTF-8'?>\n", fh);
-            fputs("<!DOCTYPE rfc PUBLIC '-//IETF//DTD RFC 2629//EN' 'http://xml.resource.org/authoring/rfc2629.dtd'>\n", fh);
-         }
-
-         const Node* title        = findChildNode(publication, "title");
-         const Node* author       = findChildNode(publication, "author");
-         const Node* year         = findChildNode(publication, "year");
-         const Node* month        = findChildNode(publication, "month");
-         const Node* day          = findChildNode(publication, "day");
-         const Node* url          = findChildNode(publication, "url");
-         const Node* urlMime      = findChildNode(publication, "url.mime");
-         const Node* urlSize      = findChildNode(publication, "url.size");
-         const Node* type         = findChildNode(publication, "type");
-         const Node* howpublished = findChildNode(publication, "howpublished");
-         const Node* booktitle    = findChildNode(publication, "booktitle");
-         const Node* journal      = findChildNode(publication, "journal");
-         const Node* volume       = findChildNode(publication, "volume");
-         const Node* number       = findChildNode(publication, "number");
-         const Node* pages        = findChildNode(publication, "pages");
-         const Node* isbn         = findChildNode(publication, "isbn");
-         const Node* issn         = findChildNode(publication, "issn");
-         const Node* doi          = findChildNode(publication, "doi");
-
-         if(url == nullptr) {
-            fprintf(fh, "<reference anchor=\"%s\">\n",
-                    labelToXMLLabel(publication->keyword).c_str());
-         }
-         else {
-            fprintf(fh, "<reference anchor=\"%s\" target=\"%s\">\n",
-                    labelToXMLLabel(publication->keyword).c_str(),
-                    url->value.c_str());
-         }
-         fputs("\t<front>\n", fh);
-         if(title) {
-            fprintf(fh, "\t\t<title>%s</title>\n", string2xml(title->value).c_str());
-         }
-         if(author) {
-            for(size_t authorIndex = 0; authorIndex < author->arguments.size(); authorIndex += 3) {
-               std::string familyName = author->arguments[authorIndex + 0];
-               std::string givenName  = author->arguments[authorIndex + 1];
-               std::string initials   = author->arguments[authorIndex + 2];
-               removeBrackets(familyName);
-               removeBrackets(givenName);
-               removeBrackets(initials);
-               fprintf(fh,
-                  "\t\t<author initials=\"%s\" surname=\"%s\" fullname=\"%s\" />\n",
-                  string2xml(initials).c_str(), string2xml(familyName).c_str(),
-                  string2xml(givenName +
-                             ((givenName != "") ? "~" : "") +
-                             familyName).c_str());
+            if(renderXMLs) {
+               xmls[i] = "<!-- " + publication->keyword + " -->\n\n";
             }
          }
-         if(year || month || day) {
-            fputs("\t\t<date ", fh);
-            if(day) {
-               fprintf(fh, "day=\"%u\" ", day->number);
+         else {
+            if(renderBibTeXs) {
+               renderBibTeX(bibTeXs[i], publication, sinks);
             }
-            if(month) {
-               static const char* xmlMonthNames[12] = {"January", "February", "March", "April", "May", "June", "July", "August", "September", "October", "November", "December"};
-               if((month->number >= 1) && (month->number <= 12)) {
-                  fprintf(fh, "month=\"%s\" ", xmlMonthNames[month->number - 1]);
+            if( (renderXMLs) || (renderJSONs) ) {
+               ExportFields fields;
+               resolveExportFields(publication, fields);
+               if(renderXMLs) {
+                  renderXML(xmls[i], publication, fields);
                }
-            }
-            if(year) {
-               fprintf(fh, "year=\"%u\" ", year->number);
-            }
-            fputs("/>\n", fh);
-         }
-         fputs("\t</front>\n", fh);
-
-         std::string seriesName  = "";
-         std::string seriesValue = "";
-         if(howpublished) {
-            seriesName = howpublished->value;
-         }
-         if(booktitle) {
-            seriesName = booktitle->value;
-         }
-         if(journal) {
-            seriesName = journal->value;
-         }
-         if(type) {
-            seriesName = type->value;
-            if(number) {
-               if(seriesValue != "") {
-                  seriesValue += ", ";
+               if(renderJSONs) {
+                  renderJSON(jsons[i], publication, fields, sinks);
                }
-               seriesValue += number->value;
-               number = nullptr;
             }
          }
-         if(number) {
-            if(seriesValue != "") {
-               seriesValue += ", ";
-            }
-            seriesValue += "Number " + number->value;
+      });
+
+      // ====== Write the results in the original order =====================
+      separateFiles.clear();
+      for(size_t i = 0; i < blockEntries; i++) {
+         const Node* publication = publicationSet->get(blockStart + i);
+         if(bibTeXFH != nullptr) {
+            fwrite(bibTeXs[i].data(), 1, bibTeXs[i].size(), bibTeXFH);
          }
-         if(volume) {
-            if(seriesValue != "") {
-               seriesValue += ", ";
-            }
-            seriesValue += "Volume " + volume->value;
+         if(xmlFH != nullptr) {
+            fwrite(xmls[i].data(), 1, xmls[i].size(), xmlFH);
          }
-         if(pages) {
-            if(seriesValue != "") {
-               seriesValue += ", ";
-            }
-            seriesValue += "Pages " + pages->value;
+         if(jsonFH != nullptr) {
+            fwrite(jsons[i].data(), 1, jsons[i].size(), jsonFH);
          }
-         if(issn) {
-            if(seriesValue != "") {
-               seriesValue += ", ";
+         if(publication->value != "Comment") {
+            if(sinks.separateBibTeXsPrefix != nullptr) {
+               separateFiles.push_back(OutputFile {
+                  sinks.separateBibTeXsPrefix + publication->keyword + ".bib",
+                  "BibTeX", nullptr, &bibTeXs[i], 0, false, false });
             }
-            seriesValue += "ISSN~" + issn->value;
-         }
-         if(isbn) {
-            if(seriesValue != "") {
-               seriesValue += ", ";
-            }
-            seriesValue += "ISBN~" + isbn->value;
-         }
-         if(doi) {
-            if(seriesValue != "") {
-               seriesValue += ", ";
+            if(sinks.separateXMLsPrefix != nullptr) {
+               separateFiles.push_back(OutputFile {
+                  sinks.separateXMLsPrefix + publication->keyword + ".xml",
+                  "XML", xmlHeader, &xmls[i], 0, false, false });
             }
-            seriesValue += "DOI~" + doi->value;
          }
-         if((seriesName != "") || (seriesValue != "")) {
-            if(seriesValue == "") {
-               // This would produce an ugly space.
-               seriesValue = seriesName;
-               seriesName  = "";
-            }
-            fprintf(fh, "\t<seriesInfo name=\"%s\" value=\"%s\" />\n",
-                    string2xml(seriesName).c_str(),
-                    string2xml(seriesValue).c_str());
-         }
-
-         if(url) {
-            std::string type = "";
-            if(urlMime) {
-               const size_t slash = urlMime->value.find("/");
-               if(slash != std::string::npos) {
-                  type = urlMime->value.substr(slash + 1, urlMime->value.size() - slash);
-                  std::transform(type.begin(), type.end(), type.begin(),
-                                 (int(*)(int))std::toupper);
-                  if(type == "PLAIN") {
-                     type = "TXT";
-                  }
-               }
-            }
-            type = " type=\"" + type + "\"";
-
-            std::string octets = "";
-            if(urlSize) {
-               octets = format(" octets=\"%u\"", atol(urlSize->value.c_str()));
-            }
+      }
 
-            fprintf(fh, "\t<format%s%s target=\"%s\" />\n",
-                    type.c_str(), octets.c_str(),
-                    url->value.c_str());
-         }
-         fputs("</reference>\n\n", fh);
+      // ====== Write the separate files of the block as one batch ==========
+      if(!batchWriter.write(separateFiles)) {
+         success = false;
+         aborted = true;
       }
+   }
 
-      if( (separateFiles) && (fh != nullptr)) {
-         fclose(fh);
-         fh = nullptr;
+   if(bibTeXFH != nullptr) {
+      if(!batchWriter.closeCombinedFile(bibTeXFH, sinks.bibTeXFile, "BibTeX",
+                                        bibTeXTemporaryFileName)) {
+         success = false;
+      }
+   }
+   if(xmlFH != nullptr) {
+      if(!batchWriter.closeCombinedFile(xmlFH, sinks.xmlFile, "XML",
+                                        xmlTemporaryFileName)) {
+         success = false;
+      }
+   }
+   if(jsonFH != nullptr) {
+      if(!batchWriter.closeCombinedFile(jsonFH, sinks.jsonFile, "JSON",
+                                        jsonTemporaryFileName)) {
+         success = false;
       }
    }
 
-   if(!separateFiles) {
-      fclose(fh);
+   if( (sinks.onlyWriteChangedFiles) && (!sinks.quietMode) ) {
+      fprintf(stderr, "Export: %u files changed, %u unchanged.\n",
+              batchWriter.getChangedFiles(), batchWriter.getUnchangedFiles());
    }
-   return true;
+   return success;
+}
+
+
+// ###### Export to BibTeX ##################################################
+bool PublicationSet::exportPublicationSetToBibTeX(PublicationSet* publicationSet,
+                                                  const char*     fileNamePrefix,
+                                                  const bool      separateFiles,
+                                                  const bool      skipNotesWithISBNandISSN,
+                                                  const bool      addNotesWithISBNandISSN,
+                                                  const bool      addUrlCommand)
+{
+   ExportSinks sinks;
+   sinks.bibTeXFile               = (separateFiles) ? nullptr : fileNamePrefix;
+   sinks.separateBibTeXsPrefix    = (separateFiles) ? fileNamePrefix : nullptr;
+   sinks.skipNotesWithISBNandISSN = skipNotesWithISBNandISSN;
+   sinks.addNotesWithISBNandISSN  = addNotesWithISBNandISSN;
+   sinks.addUrlCommand            = addUrlCommand;
+   return exportPublicationSet(publicationSet, sinks);
+}
+
+
+// ###### Export to XML #####################################################
+bool PublicationSet::exportPublicationSetToXML(PublicationSet* publicationSet,
+                                               const char*     fileNamePrefix,
+                                               const bool      separateFiles)
+{
+   ExportSinks sinks;
+   sinks.xmlFile            = (separateFiles) ? nullptr : fileNamePrefix;
+   sinks.separateXMLsPrefix = (separateFiles) ? fileNamePrefix : nullptr;
+   return exportPublicationSet(publicationSet, sinks);
 }
 
 
@@ -663,7 +1022,7 @@ std::string PublicationSet::applyTemplate(Node*                           public
          }
          else if(action == "author-initials") {   // Current author given name initials
             if(author) {
-               std::string initials   = author->arguments[authorIndex + 2];
+               std::string initials   = getAuthorName(author->authorIDs[authorIndex])->initials;
                removeBrackets(initials);
                if(initials != "") {
                   result += string2utf8(initials, nbsp, lineBreak, xmlStyle);
@@ -679,7 +1038,7 @@ std::string PublicationSet::applyTemplate(Node*                           public
                fputs("WARNING: author-give-name is deprecated, use author-given-name instead!\n", stderr);
             }
             if(author) {
-               std::string givenName  = author->arguments[authorIndex + 1];
+               std::string givenName  = getAuthorName(author->authorIDs[authorIndex])->givenName;
                removeBrackets(givenName);
                if(givenName != "") {
                   result += string2utf8(givenName, nbsp, lineBreak, xmlStyle);
@@ -691,7 +1050,7 @@ std::string PublicationSet::applyTemplate(Node*                           public
          }
          else if(action == "author-family-name") {   // Current author family name
             if(author) {
-               std::string familyName = author->arguments[authorIndex + 0];
+               std::string familyName = getAuthorName(author->authorIDs[authorIndex])->familyName;
                removeBrackets(familyName);
                result += string2utf8(familyName, nbsp, lineBreak, xmlStyle);
             }
@@ -749,12 +1108,12 @@ std::string PublicationSet::applyTemplate(Node*                           public
          }
          else if(action == "is-last-author?") {        // IS last author
             if(skip == false) {
-               skip = ! ((author != nullptr) && (authorIndex + 3 >= author->arguments.size()));
+               skip = ! ((author != nullptr) && (authorIndex + 1 >= author->authorIDs.size()));
             }
          }
          else if(action == "is-not-last-author?") {    // IS NOT last author
             if(skip == false) {
-               skip = ((author != nullptr) && (authorIndex + 3 >= author->arguments.size()));
+               skip = ((author != nullptr) && (authorIndex + 1 >= author->authorIDs.size()));
             }
          }
          else if(action == "end-author-loop") {   // Author LOOP EBD
@@ -762,8 +1121,8 @@ std::string PublicationSet::applyTemplate(Node*                           public
                fputs("ERROR: Unexpected author loop end %A -> %a author loop begin needed first!\n", stderr);
                exit(1);
             }
-            authorIndex += 3;
-            if( (author != nullptr) && (authorIndex < author->arguments.size()) ) {
+            authorIndex++;
+            if( (author != nullptr) && (authorIndex < author->authorIDs.size()) ) {
                i = authorBegin;
             }
             else {
@@ -1017,16 +1376,16 @@ std::string PublicationSet::applyTemplate(Node*                           public
                fprintf(stderr, "ERROR: Mapping \"%s\" does not exist! Forgot parameter \"--mapping %s:mapping_file:key_column:value_column\"?\n", mappingName.c_str(), mappingName.c_str());
                exit(1);
             }
-            StackEntry  entry = stack.back();
-            std::string value;
-            std::string key  = result.substr(entry.pos);
-            // fprintf(stderr, "<%s> => ", key.c_str());
-            replaceAll(key, nbsp, " ");
-            // fprintf(stderr, "<%s>\n", key.c_str());
-            skip = !mappings.map(mappingEntry, key, value);
+            // The key is looked up directly in the output buffer, with nbsp
+            // treated as space.
+            StackEntry       entry = stack.back();
+            std::string_view value;
+            skip = !mappings.map(mappingEntry,
+                                 std::string_view(result).substr(entry.pos),
+                                 nbsp, value);
             if(!skip) {
                result.erase(entry.pos);   // Remove the written key string.
-               result += value;
+               result.append(value);
             }
          }
          else if(action == "exec") {   // Execute command and pipe in the result
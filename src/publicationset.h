@@ -38,6 +38,23 @@
 #include "stringhandling.h"
 
 
+// Export targets for PublicationSet::exportPublicationSet()
+// (nullptr: target not requested)
+struct ExportSinks
+{
+   const char* bibTeXFile               = nullptr;
+   const char* separateBibTeXsPrefix    = nullptr;
+   const char* xmlFile                  = nullptr;
+   const char* separateXMLsPrefix       = nullptr;
+   const char* jsonFile                 = nullptr;
+   bool        skipNotesWithISBNandISSN = false;
+   bool        addNotesWithISBNandISSN  = false;
+   bool        addUrlCommand            = false;
+   bool        onlyWriteChangedFiles    = false;
+   bool        quietMode                = false;
+};
+
+
 class PublicationSet
 {
    public:
@@ -66,6 +83,8 @@ class PublicationSet
                                            const std::string& anchor,
                                            const std::string& mimeString);
 
+   static bool exportPublicationSet(PublicationSet*    publicationSet,
+                                    const ExportSinks& sinks);
    static bool exportPublicationSetToBibTeX(PublicationSet* publicationSet,
                                             const char*     fileNamePrefix,
                                             const bool      separateFiles,
@@ -205,11 +205,32 @@ std::string string2utf8(const std::string& string,
 {
    std::string result(string);
 
+   // Most strings contain only few (or none) of the characters starting a
+   // replacement. Entries whose first two characters do not occur in the
+   // string cannot match, so their search is skipped. Since replacements
+   // are applied one after another, the characters of a replacement are
+   // added after it has been made.
+   bool present[256];
+   memset(&present, 0, sizeof(present));
+   for(const char c : result) {
+      present[(unsigned char)c] = true;
+   }
+
    // std::cout << "IN= " << result << "\n";
    for(size_t i = 0; i < (sizeof(replaceTable) / sizeof(ReplaceTableEntry)); i++) {
-      replaceAll(result,
-                 replaceTable[i].input,
-                 ((xmlStyle == true) ? replaceTable[i].xmlOutput : replaceTable[i].utf8Output));
+      const std::string& input = replaceTable[i].input;
+      if( (!present[(unsigned char)input[0]]) ||
+          ( (input.size() > 1) && (!present[(unsigned char)input[1]]) ) ) {
+         continue;
+      }
+      if(result.find(input) != std::string::npos) {
+         const std::string& output = (xmlStyle == true) ? replaceTable[i].xmlOutput :
+                                                          replaceTable[i].utf8Output;
+         replaceAll(result, input, output);
+         for(const char c : output) {
+            present[(unsigned char)c] = true;
+         }
+      }
    }
    if(nbsp.size() > 0) {
       replaceAll(result, "~",  nbsp);
@@ -345,8 +366,13 @@ void splitString(std::vector<std::string>& tokenVector,
 // ###### Process backslash commands (newline, tab, etc.) ###################
 std::string processBackslash(const std::string& string)
 {
+   if(string.find('\\') == std::string::npos) {
+      return string;   // Nothing to do.
+   }
+
    const size_t size   = string.size();
    std::string  result = "";
+   result.reserve(size);
 
    for(size_t i = 0; i < size; i++) {
       if( (string[i] == '\\') && (i + 1 < size) ) {
@@ -457,6 +483,42 @@ std::string format(const char* fmt, ...)
 }
 
 
+// ###### Convert string to JSON string (without quotes) ###################
+std::string string2json(const std::string& string)
+{
+   std::string result;
+   result.reserve(string.size());
+   for(const char c : string) {
+      switch(c) {
+         case '"':
+            result += "\\\"";
+          break;
+         case '\\':
+            result += "\\\\";
+          break;
+         case '\n':
+            result += "\\n";
+          break;
+         case '\r':
+            result += "\\r";
+          break;
+         case '\t':
+            result += "\\t";
+          break;
+         default:
+            if((unsigned char)c < 0x20) {
+               result += format("\\u%04x", (unsigned int)(unsigned char)c);
+            }
+            else {
+               result += c;
+            }
+          break;
+      }
+   }
+   return result;
+}
+
+
 // ###### Replace all occurrences of fromString by toString in string #######
 void replaceAll(std::string&       string,
                 const std::string& fromString,
@@ -45,6 +45,7 @@ std::string string2utf8(const std::string& string,
 inline std::string string2xml(const std::string& string) {
    return string2utf8(string, "&#160;", "\n", true);
 }
+std::string string2json(const std::string& string);
 
 std::string& removeBrackets(std::string& string);
 std::string& trim(std::string& string);
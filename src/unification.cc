@@ -27,15 +27,44 @@
 //
 // Contact: thomas.dreibholz@gmail.com
 
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include <algorithm>
 #include <cctype>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
 
 #include "unification.h"
 #include "stringhandling.h"
+#include "workerpool.h"
+
+
+// Warnings of the entry currently processed by this thread are collected
+// here, to print them in input order after a parallel unification pass.
+static thread_local std::string* gWarningsBuffer = nullptr;
+
+
+// ###### Print warning, or add it to the thread's warnings buffer ##########
+static void printWarning(const char* fmt, ...)
+{
+   va_list va;
+   va_start(va, fmt);
+   if(gWarningsBuffer != nullptr) {
+      char buffer[16384];
+      vsnprintf(buffer, sizeof(buffer), fmt, va);
+      *gWarningsBuffer += buffer;
+   }
+   else {
+      vfprintf(stderr, fmt, va);
+   }
+   va_end(va);
+}
 
 
 // ###### Extract initials from given name(s) ###############################
@@ -165,49 +194,82 @@ static void splitAuthor(std::string& author,
 }
 
 
-// ###### Unify "author" section ############################################
-void unifyAuthor(Node* publication, Node* author)
+// ====== Author intern table ==============================================
+// Every distinct author spelling is split only once. Spellings resulting in
+// the same family/given name share one AuthorName entry (and therefore one
+// ID). Entries are never removed, so pointers to them remain valid.
+static std::shared_mutex                             gAuthorTableMutex;
+static std::deque<AuthorName>                        gAuthorNames;
+static std::unordered_map<std::string, unsigned int> gAuthorSpellings;
+static std::unordered_map<std::string, unsigned int> gAuthorCanonicalNames;
+
+
+// ###### Get author name by ID #############################################
+const AuthorName* getAuthorName(const unsigned int id)
 {
-   std::string currentAuthor;
-   std::string givenNameFull;
-   std::string givenNameInitials;
-   std::string familyName;
-
-   size_t argumentsIndex = 0;
-   author->arguments.clear();
-
-   // ====== Iterator from author 1 to author n-1 (for n authors) ===========
-   std::string allAuthors = author->value;
-   bool        empty      = true;
-   size_t      pos;
-   author->value = "";
-   while( (pos = allAuthors.find(" and ")) != std::string::npos ) {
-      currentAuthor = allAuthors.substr(0, pos);
+   std::shared_lock<std::shared_mutex> lock(gAuthorTableMutex);
+   return &gAuthorNames[id];
+}
 
-      // ====== Extract current author ======================================
-      splitAuthor(currentAuthor, givenNameFull, givenNameInitials, familyName);
-      author->value += ((!empty) ? " and " : "") + currentAuthor;
-      empty = false;
 
-      // ====== Store extracted name strings into Node's arguments vector ===
-      author->arguments.resize(argumentsIndex + 3);
-      author->arguments[argumentsIndex++] = familyName;
-      author->arguments[argumentsIndex++] = givenNameFull;
-      author->arguments[argumentsIndex++] = givenNameInitials;
+// ###### Look up or add author spelling in the author intern table #########
+static const AuthorName* internAuthorName(const std::string& spelling)
+{
+   // ====== Fast path: spelling has already been seen ======================
+   {
+      std::shared_lock<std::shared_mutex> lock(gAuthorTableMutex);
+      const auto found = gAuthorSpellings.find(spelling);
+      if(found != gAuthorSpellings.end()) {
+         return &gAuthorNames[found->second];
+      }
+   }
 
-      pos += 5;
-      allAuthors = allAuthors.substr(pos, allAuthors.size() - pos);
+   // ====== Split new spelling (without holding the lock) ==================
+   AuthorName name;
+   name.fullName = spelling;
+   splitAuthor(name.fullName, name.givenName, name.initials, name.familyName);
+   const std::string canonicalName = name.familyName + '\n' + name.givenName;
+
+   // ====== Add it to the table ============================================
+   std::unique_lock<std::shared_mutex> lock(gAuthorTableMutex);
+   const auto found = gAuthorSpellings.find(spelling);
+   if(found != gAuthorSpellings.end()) {   // Added by another thread meanwhile
+      return &gAuthorNames[found->second];
+   }
+   unsigned int id;
+   const auto canonical = gAuthorCanonicalNames.find(canonicalName);
+   if(canonical != gAuthorCanonicalNames.end()) {
+      id = canonical->second;
+   }
+   else {
+      id      = (unsigned int)gAuthorNames.size();
+      name.id = id;
+      gAuthorNames.emplace_back(std::move(name));
+      gAuthorCanonicalNames.insert(std::make_pair(canonicalName, id));
    }
+   gAuthorSpellings.insert(std::make_pair(spelling, id));
+   return &gAuthorNames[id];
+}
+
 
-   // ====== Extract last author ============================================
-   splitAuthor(allAuthors, givenNameFull, givenNameInitials, familyName);
-   author->value += ((!empty) ? " and " : "") + allAuthors;
+// ###### Unify "author" section ############################################
+void unifyAuthor(Node* publication, Node* author)
+{
+   const std::string allAuthors = author->value;
+   size_t            begin      = 0;
+   size_t            end;
 
-   // ====== Store extracted name strings into Node's arguments vector ======
-   author->arguments.resize(argumentsIndex + 3);
-   author->arguments[argumentsIndex++] = familyName;
-   author->arguments[argumentsIndex++] = givenNameFull;
-   author->arguments[argumentsIndex++] = givenNameInitials;
+   author->authorIDs.clear();
+   author->value = "";
+   do {
+      end = allAuthors.find(" and ", begin);
+      const AuthorName* name =
+         internAuthorName(allAuthors.substr(begin, (end != std::string::npos) ?
+                                                      end - begin : std::string::npos));
+      author->value += ((begin > 0) ? " and " : "") + name->fullName;
+      author->authorIDs.push_back(name->id);
+      begin = end + 5;
+   } while(end != std::string::npos);
 }
 
 
@@ -239,7 +301,7 @@ void unifyISBN(Node* publication, Node* isbn)
 
       }
       else {
-         fprintf(stderr, "WARNING: Entry %s has invalid characters in \"isbn\" section (isbn=%s)!\n" ,
+         printWarning("WARNING: Entry %s has invalid characters in \"isbn\" section (isbn=%s)!\n" ,
                  publication->keyword.c_str(), isbn->value.c_str());
          return;
       }
@@ -258,7 +320,7 @@ void unifyISBN(Node* publication, Node* isbn)
       char value = ((checksum < 10) ? ((char)checksum + '0') : 'X');
 
       if(value != number[9]) {
-         fprintf(stderr, "WARNING: Entry %s has invalid ISBN-10 in \"isbn\" section (isbn=%s; checksum=%c)\n" ,
+         printWarning("WARNING: Entry %s has invalid ISBN-10 in \"isbn\" section (isbn=%s; checksum=%c)\n" ,
                  publication->keyword.c_str(), isbn->value.c_str(), value);
       }
    }
@@ -282,12 +344,12 @@ void unifyISBN(Node* publication, Node* isbn)
       char value = (char)checksum + '0';
 
       if(value != number[12]) {
-         fprintf(stderr, "WARNING: Entry %s has invalid ISBN-13 in \"isbn\" section (isbn=%s; checksum=%c)\n" ,
+         printWarning("WARNING: Entry %s has invalid ISBN-13 in \"isbn\" section (isbn=%s; checksum=%c)\n" ,
                  publication->keyword.c_str(), isbn->value.c_str(), value);
       }
    }
    else {
-      fprintf(stderr, "WARNING: Entry %s has no ISBN-10 or ISBN-13 in \"isbn\" section (isbn=%s -> %s)\n" ,
+      printWarning("WARNING: Entry %s has no ISBN-10 or ISBN-13 in \"isbn\" section (isbn=%s -> %s)\n" ,
               publication->keyword.c_str(), isbn->value.c_str(), number.c_str());
       return;
    }
@@ -312,7 +374,7 @@ void unifyISSN(Node* publication, Node* issn)
 
       }
       else {
-         fprintf(stderr, "WARNING: Entry %s has invalid characters in \"issn\" section (issn=%s)!\n" ,
+         printWarning("WARNING: Entry %s has invalid characters in \"issn\" section (issn=%s)!\n" ,
                  publication->keyword.c_str(), issn->value.c_str());
          return;
       }
@@ -332,12 +394,12 @@ void unifyISSN(Node* publication, Node* issn)
       char value = ((checksum < 10) ? ((char)checksum + '0') : 'X');
 
       if(value != number[7]) {
-         fprintf(stderr, "WARNING: Entry %s has invalid ISSN-10 in \"issn\" section (issn=%s; checksum=%c)\n" ,
+         printWarning("WARNING: Entry %s has invalid ISSN-10 in \"issn\" section (issn=%s; checksum=%c)\n" ,
                  publication->keyword.c_str(), issn->value.c_str(), value);
       }
    }
    else {
-      fprintf(stderr, "WARNING: Entry %s has no ISSN in \"issn\" section (issn=%s -> %s)\n" ,
+      printWarning("WARNING: Entry %s has no ISSN in \"issn\" section (issn=%s -> %s)\n" ,
               publication->keyword.c_str(), issn->value.c_str(), number.c_str());
       return;
    }
@@ -351,14 +413,14 @@ void unifyDate(Node* publication, Node* year, Node* month, Node* day)
    if(year != nullptr) {
       yearNumber = atol(year->value.c_str());
       if((yearNumber < 1700) || (yearNumber > 2030)) {
-         fprintf(stderr, "WARNING: Entry %s has probably invalid \"year\" section (year=%d?)!\n" ,
+         printWarning("WARNING: Entry %s has probably invalid \"year\" section (year=%d?)!\n" ,
                  publication->keyword.c_str(), yearNumber);
       }
       year->number = yearNumber;
       year->value  = format("%04d", yearNumber);
    }
    else {
-      fprintf(stderr, "WARNING: Entry %s has no \"year\" section, but \"month\" or \"day\"!\n" ,
+      printWarning("WARNING: Entry %s has no \"year\" section, but \"month\" or \"day\"!\n" ,
               publication->keyword.c_str());
    }
 
@@ -413,7 +475,7 @@ void unifyDate(Node* publication, Node* year, Node* month, Node* day)
          monthNumber = 12;   maxDays = 31;
       }
       else {
-         fprintf(stderr, "WARNING: Entry %s has probably invalid \"month\" section (month=%s?)!\n" ,
+         printWarning("WARNING: Entry %s has probably invalid \"month\" section (month=%s?)!\n" ,
                  publication->keyword.c_str(), monthName.c_str());
       }
       month->number = monthNumber;
@@ -423,12 +485,12 @@ void unifyDate(Node* publication, Node* year, Node* month, Node* day)
    if(day != nullptr) {
       day->number = atol(day->value.c_str());
       if(month == nullptr) {
-         fprintf(stderr, "WARNING: Entry %s has no \"month\" section, but \"day\"!\n" ,
+         printWarning("WARNING: Entry %s has no \"month\" section, but \"day\"!\n" ,
                  publication->keyword.c_str());
       }
       else {
          if((day->number < 1) || (day->number > maxDays)) {
-            fprintf(stderr, "WARNING: Entry %s has invalid \"day\" or \"month\" section (year=%d month=%d day=%d)!\n" ,
+            printWarning("WARNING: Entry %s has invalid \"day\" or \"month\" section (year=%d month=%d day=%d)!\n" ,
                     publication->keyword.c_str(), yearNumber, monthNumber, day->number);
          }
       }
@@ -499,14 +561,14 @@ void unifyPages(Node* publication, Node* pages)
       if(numpages) {
          unsigned int n = atol(numpages->value.c_str());
          if(n != 1 + (b - a)) {
-            fprintf(stderr, "WARNING: Entry %s has inconsistent invalid page numbers and number of pages (pages=%s; numpages=%s)!\n" ,
+            printWarning("WARNING: Entry %s has inconsistent invalid page numbers and number of pages (pages=%s; numpages=%s)!\n" ,
                     publication->keyword.c_str(), pages->value.c_str(), numpages->value.c_str());
          }
       }
       addOrUpdateChildNode(publication, "numpages", format("%u", 1 + (b - a)).c_str());
    }
    else {
-      fprintf(stderr, "WARNING: Entry %s has possibly invalid page numbers in \"pages\" section (pages=%s)!\n" ,
+      printWarning("WARNING: Entry %s has possibly invalid page numbers in \"pages\" section (pages=%s)!\n" ,
               publication->keyword.c_str(), pages->value.c_str());
    }
 }
@@ -517,8 +579,177 @@ void unifyNumPages(Node* publication, Node* numpages)
 {
    const unsigned int numberOfPages = atol(numpages->value.c_str());
    if( (numberOfPages < 1) || (numberOfPages >= 999999) ) {
-      fprintf(stderr, "WARNING: Entry %s has invalid page of numbers in \"numpages\" section (numpages=%s)!\n" ,
+      printWarning("WARNING: Entry %s has invalid page of numbers in \"numpages\" section (numpages=%s)!\n" ,
               publication->keyword.c_str(), numpages->value.c_str());
    }
    numpages->value = format("%u", numberOfPages);
 }
+
+
+// ###### Check number of occurrences for a field ###########################
+static bool requiresField(const Node* publication,
+                          const char* field,
+                          const size_t minimum,
+                          const size_t maximum)
+{
+   const size_t count = countChildNodes(publication, field);
+   if(count < minimum) {
+      printWarning("WARNING: Entry %s has no \"%s\" section!\n",
+                   publication->keyword.c_str(),
+                   field);
+      return false;
+   }
+   else if(count > maximum) {
+      printWarning("WARNING: Entry %s has %u \"%s\" sections!\n",
+                   publication->keyword.c_str(),
+                   (unsigned int)count, field);
+      return false;
+   }
+   return true;
+}
+
+
+// ###### Unify publication #################################################
+void unifyPublication(Node* publication)
+{
+   if(publication->unified) {
+      return;   // Already done.
+   }
+   publication->unified = true;
+
+   sortChildren(publication);
+
+   if(publication->value != "Comment") {
+      requiresField(publication, "title",        1, 1);
+      requiresField(publication, "author",       1, 1);
+      requiresField(publication, "year",         1, 1);
+      requiresField(publication, "isbn",         0, 1);
+      requiresField(publication, "issn",         0, 1);
+      requiresField(publication, "doi",          0, 1);
+      requiresField(publication, "url",          0, 1);
+      requiresField(publication, "url.size",     0, 1);
+      requiresField(publication, "url.mime",     0, 1);
+      requiresField(publication, "url.md5",      0, 1);
+      requiresField(publication, "url.checked",  0, 1);
+      requiresField(publication, "url.etag",     0, 1);
+      requiresField(publication, "url.lastmodified", 0, 1);
+      requiresField(publication, "urn",          0, 1);
+      requiresField(publication, "pages",        0, 1);
+      requiresField(publication, "numpages",     0, 1);
+      requiresField(publication, "day",          0, 1);
+      requiresField(publication, "month",        0, 1);
+      requiresField(publication, "address",      0, 1);
+      requiresField(publication, "location",     0, 1);
+      requiresField(publication, "note",         0, 1);
+      requiresField(publication, "howpublished", 0, 1);
+      requiresField(publication, "publisher",    0, 1);
+      requiresField(publication, "school",       0, 1);
+      requiresField(publication, "institution",  0, 1);
+      requiresField(publication, "type",         0, 1);
+      requiresField(publication, "number",       0, 1);
+      requiresField(publication, "issue",        0, 1);
+      requiresField(publication, "volume",       0, 1);
+      requiresField(publication, "abstract",     0, 1);
+      requiresField(publication, "keywords",     0, 1);
+      if(publication->value == "Article") {
+         requiresField(publication, "journal", 1, 1);
+      }
+      else if(publication->value == "Book") {
+         requiresField(publication, "publisher", 1, 1);
+      }
+      else if(publication->value == "InProceedings") {
+         requiresField(publication, "booktitle", 1, 1);
+      }
+      else if(publication->value == "TechReport") {
+         requiresField(publication, "institution", 1, 1);
+      }
+      else if(publication->value == "Online") {
+         requiresField(publication, "url", 1, 1);
+      }
+
+      Node* author = findChildNode(publication, "author");
+      if(author != nullptr) {
+         unifyAuthor(publication, author);
+      }
+      else {
+         printWarning("WARNING: Entry %s has no \"author\" section!\n",
+                      publication->keyword.c_str());
+      }
+
+      Node* booktitle = findChildNode(publication, "booktitle");
+      if(booktitle != nullptr) {
+         unifyBookTitle(publication, booktitle);
+      }
+      Node* howPublished = findChildNode(publication, "howPublished");
+      if(howPublished != nullptr) {
+         unifyBookTitle(publication, howPublished);
+      }
+      Node* journal = findChildNode(publication, "journal");
+      if(journal != nullptr) {
+         unifyBookTitle(publication, journal);   // Same as for booktitle!
+      }
+      Node* pages = findChildNode(publication, "pages");
+      if(pages != nullptr) {
+         unifyPages(publication, pages);
+      }
+      Node* numpages = findChildNode(publication, "numpages");
+      if(numpages != nullptr) {
+         unifyNumPages(publication, numpages);
+      }
+
+      Node* isbn = findChildNode(publication, "isbn");
+      if(isbn != nullptr) {
+         unifyISBN(publication, isbn);
+      }
+      Node* issn = findChildNode(publication, "issn");
+      if(issn != nullptr) {
+         unifyISSN(publication, issn);
+      }
+
+      Node* year  = findChildNode(publication, "year");
+      Node* month = findChildNode(publication, "month");
+      Node* day   = findChildNode(publication, "day");
+      if( (year != nullptr) || (month != nullptr) || (day != nullptr) ) {
+         unifyDate(publication, year, month, day);
+      }
+
+      Node* url = findChildNode(publication, "url");
+      if(url != nullptr) {
+         unifyURL(publication, url);
+      }
+   }
+}
+
+
+// ###### Unify all publications of a collection ############################
+// The entries are independent of each other, i.e. they can be unified in
+// parallel. To keep the output deterministic, the warnings of each entry
+// are buffered and printed in input order afterwards.
+// Returns the number of entries having warnings.
+size_t unifyPublications(Node* publicationCollection)
+{
+   std::vector<Node*> publications;
+   publications.reserve(countNodes(publicationCollection));
+   for(Node* publication = publicationCollection; publication != nullptr;
+       publication = publication->next) {
+      if(!publication->unified) {
+         publications.push_back(publication);
+      }
+   }
+
+   std::vector<std::string> warnings(publications.size());
+   runInParallel(publications.size(), [&](const size_t index) {
+      gWarningsBuffer = &warnings[index];
+      unifyPublication(publications[index]);
+      gWarningsBuffer = nullptr;
+   });
+
+   size_t entriesWithWarnings = 0;
+   for(const std::string& entryWarnings : warnings) {
+      if(!entryWarnings.empty()) {
+         fputs(entryWarnings.c_str(), stderr);
+         entriesWithWarnings++;
+      }
+   }
+   return entriesWithWarnings;
+}
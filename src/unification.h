@@ -35,6 +35,20 @@
 #include <string>
 
 
+// Unified author name, shared by all entries using this author.
+struct AuthorName {
+   std::string  fullName;     // Unified name, as written into "author"
+   std::string  familyName;
+   std::string  givenName;
+   std::string  initials;
+   unsigned int id;
+};
+
+const AuthorName* getAuthorName(const unsigned int id);
+
+void unifyPublication(Node* publication);
+size_t unifyPublications(Node* publicationCollection);
+
 void unifyAuthor(Node* publication, Node* author);
 void unifyBookTitle(Node* publication, Node* booktitle);
 void unifyISBN(Node* publication, Node* isbn);
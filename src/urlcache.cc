@@ -0,0 +1,232 @@
+// ==========================================================================
+//                ____  _ _   _____   __  ______
+//                | __ )(_) |_|_   _|__\ \/ / ___|___  _ ____   __
+//                |  _ \| | '_ \| |/ _ \  / |   / _ \| '_ \ \ / /
+//                | |_) | | |_) | |  __//  \ |__| (_) | | | \ V /
+//                |____/|_|_.__/|_|\___/_/\_\____\___/|_| |_|\_/
+//
+//                          ---  BibTeX Converter  ---
+//                   https://www.nntb.no/~dreibh/bibtexconv/
+// ==========================================================================
+//
+// BibTeX Converter
+// Copyright (C) 2010-2026 by Thomas Dreibholz
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Contact: thomas.dreibholz@gmail.com
+
+#include "urlcache.h"
+#include "stringhandling.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+
+// ###### Constructor #######################################################
+URLCache::URLCache()
+{
+}
+
+
+// ###### Destructor ########################################################
+URLCache::~URLCache()
+{
+}
+
+
+// ###### Load cache file ###################################################
+// A missing cache file is not an error: it is created by save().
+bool URLCache::load(const char* cacheFileName)
+{
+   fileName = cacheFileName;
+   entries.clear();
+
+   FILE* fh = fopen(cacheFileName, "r");
+   if(fh == nullptr) {
+      if(errno == ENOENT) {
+         return true;
+      }
+      fprintf(stderr, "ERROR: Unable to open URL cache %s: %s!\n",
+              cacheFileName, strerror(errno));
+      return false;
+   }
+
+   char*   line     = nullptr;
+   size_t  lineSize = 0;
+   ssize_t lineLength;
+   while( (lineLength = getline(&line, &lineSize, fh)) > 0 ) {
+      if( (line[0] == '#') || (line[0] == '\n') ) {
+         continue;
+      }
+      std::string input(line, lineLength);
+      if(input[input.size() - 1] == '\n') {
+         input.resize(input.size() - 1);
+      }
+      std::vector<std::string> columns;
+      splitString(columns, input, "\t");
+      if(columns.size() == 8) {
+         URLCacheEntry entry;
+         entry.Time         = (time_t)atoll(columns[1].c_str());
+         entry.Status       = (unsigned int)atol(columns[2].c_str());
+         entry.Size         = columns[3];
+         entry.MIMEType     = columns[4];
+         entry.MD5          = columns[5];
+         entry.ETag         = columns[6];
+         entry.LastModified = columns[7];
+         entries[columns[0]] = entry;
+      }
+   }
+   free(line);
+   fclose(fh);
+   return true;
+}
+
+
+// ###### Save cache file ###################################################
+// The file is replaced atomically, i.e. an interrupted run does not leave a
+// damaged cache behind.
+bool URLCache::save() const
+{
+   if(fileName.empty()) {
+      return true;
+   }
+
+   // ====== Sort by URL, to get stable files ===============================
+   std::vector<const std::pair<const std::string, URLCacheEntry>*> sortedEntries;
+   sortedEntries.reserve(entries.size());
+   for(const std::pair<const std::string, URLCacheEntry>& entry : entries) {
+      sortedEntries.push_back(&entry);
+   }
+   std::sort(sortedEntries.begin(), sortedEntries.end(),
+             [](const std::pair<const std::string, URLCacheEntry>* a,
+                const std::pair<const std::string, URLCacheEntry>* b) {
+                return (a->first < b->first);
+             });
+
+   // ====== Write temporary file and rename it =============================
+   const std::string tempFileName = fileName + ".tmp";
+   FILE* fh = fopen(tempFileName.c_str(), "w");
+   if(fh == nullptr) {
+      fprintf(stderr, "ERROR: Unable to create URL cache %s: %s!\n",
+              tempFileName.c_str(), strerror(errno));
+      return false;
+   }
+   fputs("# URL\tTime\tStatus\tSize\tMIME Type\tMD5\tETag\tLast-Modified\n", fh);
+   for(const std::pair<const std::string, URLCacheEntry>* entry : sortedEntries) {
+      fprintf(fh, "%s\t%lld\t%u\t%s\t%s\t%s\t%s\t%s\n",
+              entry->first.c_str(),
+              (long long)entry->second.Time,
+              entry->second.Status,
+              entry->second.Size.c_str(),
+              entry->second.MIMEType.c_str(),
+              entry->second.MD5.c_str(),
+              entry->second.ETag.c_str(),
+              entry->second.LastModified.c_str());
+   }
+   if( (fclose(fh) != 0) || (rename(tempFileName.c_str(), fileName.c_str()) < 0) ) {
+      fprintf(stderr, "ERROR: Unable to write URL cache %s: %s!\n",
+              fileName.c_str(), strerror(errno));
+      unlink(tempFileName.c_str());
+      return false;
+   }
+   return true;
+}
+
+
+// ###### Find cache entry ##################################################
+const URLCacheEntry* URLCache::find(const std::string& url) const
+{
+   std::unordered_map<std::string, URLCacheEntry>::const_iterator found =
+      entries.find(url);
+   if(found != entries.end()) {
+      return &found->second;
+   }
+   return nullptr;
+}
+
+
+// ###### Update cache entry ################################################
+void URLCache::update(const std::string& url, const URLCacheEntry& entry)
+{
+   // Tabs and newlines would break the file format:
+   if( (url.find_first_of("\t\r\n") != std::string::npos) ||
+       (entry.ETag.find_first_of("\t\r\n") != std::string::npos) ||
+       (entry.LastModified.find_first_of("\t\r\n") != std::string::npos) ) {
+      return;
+   }
+   entries[url] = entry;
+}
+
+
+// ###### Check whether cache entry is fresh ################################
+// To spread the checks over time, the actual age limit of each URL is
+// between half of maxAge and maxAge, chosen by a hash of the URL. URLs
+// which have been checked at the same time therefore become due on
+// different days.
+bool URLCache::isFresh(const std::string&   url,
+                       const URLCacheEntry* entry,
+                       const time_t         now,
+                       const unsigned int   maxAge) const
+{
+   if( (entry == nullptr) || ((entry->Status != 200) && (entry->Status != 304)) ) {
+      return false;   // Failed checks are always repeated.
+   }
+   const unsigned long long spread = std::hash<std::string>()(url) % 1024;
+   const time_t limit = (time_t)(maxAge / 2) +
+                           (time_t)(((unsigned long long)(maxAge - maxAge / 2) * spread) / 1023);
+   return (now - entry->Time < limit);
+}
+
+
+// ###### Parse duration, e.g. "3600", "90m", "12h", "7d", "2w" ############
+bool parseDuration(const char* string, unsigned int& seconds)
+{
+   char*               end;
+   const unsigned long value = strtoul(string, &end, 10);
+   if(end == string) {
+      return false;
+   }
+   unsigned long factor = 1;
+   if( (strcmp(end, "") == 0) || (strcmp(end, "s") == 0) ) {
+      factor = 1;
+   }
+   else if(strcmp(end, "m") == 0) {
+      factor = 60;
+   }
+   else if(strcmp(end, "h") == 0) {
+      factor = 3600;
+   }
+   else if(strcmp(end, "d") == 0) {
+      factor = 86400;
+   }
+   else if(strcmp(end, "w") == 0) {
+      factor = 7 * 86400;
+   }
+   else {
+      return false;
+   }
+   if(value > 0xffffffffUL / factor) {
+      return false;
+   }
+   seconds = (unsigned int)(value * factor);
+   return true;
+}
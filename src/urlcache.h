@@ -0,0 +1,77 @@
+// ==========================================================================
+//                ____  _ _   _____   __  ______
+//                | __ )(_) |_|_   _|__\ \/ / ___|___  _ ____   __
+//                |  _ \| | '_ \| |/ _ \  / |   / _ \| '_ \ \ / /
+//                | |_) | | |_) | |  __//  \ |__| (_) | | | \ V /
+//                |____/|_|_.__/|_|\___/_/\_\____\___/|_| |_|\_/
+//
+//                          ---  BibTeX Converter  ---
+//                   https://www.nntb.no/~dreibh/bibtexconv/
+// ==========================================================================
+//
+// BibTeX Converter
+// Copyright (C) 2010-2026 by Thomas Dreibholz
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Contact: thomas.dreibholz@gmail.com
+
+#ifndef URLCACHE_H
+#define URLCACHE_H
+
+#include <time.h>
+
+#include <string>
+#include <unordered_map>
+
+
+// The URL cache is a sidecar file, which stores the result of the last
+// check of each URL. It is a tab-separated text file with one line per URL.
+struct URLCacheEntry {
+   time_t       Time;           // Time of the check
+   unsigned int Status;         // HTTP status, or 0 for failure
+   std::string  Size;
+   std::string  MIMEType;
+   std::string  MD5;
+   std::string  ETag;
+   std::string  LastModified;
+};
+
+class URLCache
+{
+   public:
+   URLCache();
+   ~URLCache();
+
+   bool load(const char* cacheFileName);
+   bool save() const;
+   const URLCacheEntry* find(const std::string& url) const;
+   void update(const std::string& url, const URLCacheEntry& entry);
+   bool isFresh(const std::string&   url,
+                const URLCacheEntry* entry,
+                const time_t         now,
+                const unsigned int   maxAge) const;
+
+   inline bool isEnabled() const {
+      return (!fileName.empty());
+   }
+
+   private:
+   std::string                                    fileName;
+   std::unordered_map<std::string, URLCacheEntry> entries;
+};
+
+bool parseDuration(const char* string, unsigned int& seconds);
+
+#endif
@@ -0,0 +1,1689 @@
+// ==========================================================================
+//                ____  _ _   _____   __  ______
+//                | __ )(_) |_|_   _|__\ \/ / ___|___  _ ____   __
+//                |  _ \| | '_ \| |/ _ \  / |   / _ \| '_ \ \ / /
+//                | |_) | | |_) | |  __//  \ |__| (_) | | | \ V /
+//                |____/|_|_.__/|_|\___/_/\_\____\___/|_| |_|\_/
+//
+//                          ---  BibTeX Converter  ---
+//                   https://www.nntb.no/~dreibh/bibtexconv/
+// ==========================================================================
+//
+// BibTeX Converter
+// Copyright (C) 2010-2026 by Thomas Dreibholz
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Contact: thomas.dreibholz@gmail.com
+
+#include "urlchecker.h"
+#include "mimetype.h"
+#include "pdfmetadata.h"
+#include "stringhandling.h"
+#include "workerpool.h"
+
+#include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <openssl/evp.h>
+
+#include <algorithm>
+#include <thread>
+
+
+// Reason for not checking a publication's URL
+enum SkipReason {
+   NotSkipped        = 0,
+   SkippedDownloaded = 1,   // Download is already available
+   SkippedNotNew     = 2,   // Not a new entry (checkNewURLsOnly)
+   SkippedRecent     = 3    // Checked recently, according to the cache
+};
+
+// State of the check of a publication's URL
+struct URLCheck {
+   Node*              Publication;
+   Node*              URLNode;
+   std::string        URL;                    // URL currently downloaded
+   std::string        Host;
+   std::string        Log;                    // Output, printed in order
+   bool               Done;                   // Ready to be applied
+   SkipReason         Skipped;                // No check necessary
+   bool               Good;                   // Download has been successful
+   bool               DynamicURLHandled;
+   unsigned int       HTTPStatus;
+   size_t             Sequence;               // Position in publication set
+   unsigned int       Retries;
+   const char*        DownloadDirectory;      // Not null to store download
+   size_t             BufferSize;             // Maximum data kept in memory
+   unsigned int       Errors;
+
+   // ====== Conditional requests ===========================================
+   // If the results of a previous check and its validators (url.etag,
+   // url.lastmodified) are available, the download is only repeated when
+   // the document has changed. Optionally, a HEAD request probes first.
+   bool               Conditional;            // Validators are available
+   bool               Probing;                // Transfer is a HEAD probe
+   bool               NotModified;            // Unchanged since last check
+   std::string        OldSize;
+   std::string        OldETag;
+   std::string        OldLastModified;
+   std::string        ETag;                   // Validators of the response
+   std::string        LastModified;
+   struct curl_slist* RequestHeaders;
+
+   // ====== Download =======================================================
+   // Size and MD5 are computed while receiving the data. The data is kept
+   // in memory, up to the buffer size. Beyond that, it is spilled to an
+   // anonymous temporary file (O_TMPFILE), in the download directory when
+   // storing downloads. DownloadFileName is only set for a named temporary
+   // file, which is used where O_TMPFILE is not supported.
+   CURL*              EasyHandle;
+   EVP_MD_CTX*        MD5Context;
+   unsigned long long Size;
+   std::string        Buffer;                 // Data, or its prefix if spilled
+   FILE*              DownloadFH;             // Not null, if spilled
+   char               DownloadFileName[256];
+
+   // ====== Results of post-processing =====================================
+   std::string        MD5;
+   std::string        MIMEType;
+   PDFMetadata        Metadata;
+
+   // ====== Sharing the result of identical URLs ===========================
+   // Only the first check of a URL performs the transfer. The result is
+   // handed over to its followers when it is applied.
+   std::vector<URLCheck*> Followers;
+   bool               Follower;
+   size_t             ResultLog;              // Start of the result in Log
+   std::string        StoredFileName;         // File with the stored data
+   std::string        SharedFileName;         // Stored data of the first check
+
+   // ====== Timings ========================================================
+   // The curl timings are summed up over all transfers of the check
+   // (retries, HEAD probe, dynamic URL).
+   unsigned int       Transfers;
+   unsigned long long QueuedAt;               // Time of entering a queue
+   unsigned long long Timings[URLChecker::TimingPhases];   // in us
+};
+
+
+// After spilling to a file, the first MaxPrefixSize bytes of the data are
+// still kept in memory, for MIME type detection and dynamic URL handling.
+static const size_t MaxPrefixSize = 1048576;
+
+// On HTTP 429 or 503 without Retry-After, the backoff starts at
+// InitialBackoff and doubles with each retry. Longer waits are not done.
+static const unsigned long long InitialBackoff = 1000000ULL;     // 1 s
+static const unsigned long long MaxBackoff     = 300000000ULL;   // 5 min
+
+
+// ###### Get current timer #################################################
+static unsigned long long getMicroTime()
+{
+  struct timeval tv;
+  gettimeofday(&tv,nullptr);
+  return ((unsigned long long)tv.tv_sec * (unsigned long long)1000000) +
+            (unsigned long long)tv.tv_usec;
+}
+
+
+// ###### Get host name of URL ##############################################
+static std::string getHost(const std::string& url)
+{
+   size_t begin = url.find("://");
+   begin = (begin != std::string::npos) ? begin + 3 : 0;
+   size_t end = url.find_first_of("/?#", begin);
+   if(end == std::string::npos) {
+      end = url.size();
+   }
+   const size_t at = url.rfind('@', end);
+   if( (at != std::string::npos) && (at >= begin) ) {
+      begin = at + 1;
+   }
+   std::string host = url.substr(begin, end - begin);
+   std::transform(host.begin(), host.end(), host.begin(), ::tolower);
+   return host;
+}
+
+
+// ###### Constructor #######################################################
+URLChecker::URLChecker()
+{
+   downloadDirectory     = nullptr;
+   contentAddressedStore = false;
+   checkNewURLsOnly      = false;
+   ignoreUpdatesForHTML  = false;
+   quietMode             = false;
+   parallelism           = 1;
+   hostParallelism       = 1;
+   headProbe             = false;
+   urlCache              = nullptr;
+   recheckAfter          = 0;
+   hostDelay             = 0;
+   bufferSize            = 16 * 1048576;
+   timingReport          = nullptr;
+   retries               = 2;
+   multiHandle           = nullptr;
+   shareHandle           = nullptr;
+   transfers             = 0;
+   postProcessingStop    = false;
+}
+
+
+// ###### Destructor ########################################################
+URLChecker::~URLChecker()
+{
+}
+
+
+// ###### Prepare check of a publication's URL ##############################
+URLCheck* URLChecker::prepareCheck(Node* publication, Node* url)
+{
+   URLCheck* check = new URLCheck;
+   assert(check != nullptr);
+   check->Publication         = publication;
+   check->URLNode             = url;
+   check->URL                 = url->value;
+   check->Host                = getHost(url->value);
+   check->Done                = false;
+   check->Skipped             = NotSkipped;
+   check->Good                = false;
+   check->DynamicURLHandled   = false;
+   check->DownloadDirectory   = downloadDirectory;
+   check->BufferSize          = bufferSize;
+   check->Errors              = 0;
+   check->HTTPStatus          = 0;
+   check->Sequence            = 0;
+   check->Retries             = 0;
+   check->Conditional         = false;
+   check->Probing             = false;
+   check->NotModified         = false;
+   check->RequestHeaders      = nullptr;
+   check->EasyHandle          = nullptr;
+   check->MD5Context          = nullptr;
+   check->Size                = 0;
+   check->DownloadFH          = nullptr;
+   check->DownloadFileName[0] = 0x00;
+   check->Follower            = false;
+   check->ResultLog           = 0;
+   check->Transfers           = 0;
+   check->QueuedAt            = 0;
+   for(unsigned int i = 0; i < TimingPhases; i++) {
+      check->Timings[i] = 0;
+   }
+   clearPDFMetadata(check->Metadata);
+
+   // ====== Skip already checked entries, if requested =====================
+   const Node* urlSize    = findChildNode(publication, "url.size");
+   const Node* urlMime    = findChildNode(publication, "url.mime");
+   const Node* urlChecked = findChildNode(publication, "url.checked");
+   if( (urlSize != nullptr) && (urlMime != nullptr) && (urlChecked != nullptr) ) {
+      if(downloadDirectory != nullptr) {
+         // The download directory has been listed once, by checkAll():
+         const std::string downloadFileName =
+            PublicationSet::makeDownloadFileName(nullptr, publication->keyword, urlMime->value);
+         if(downloadFiles.find(downloadFileName) != downloadFiles.end()) {
+            if(!quietMode) {
+               check->Log += format("Skipping URL of %s (already available as %s).\n",
+                                    publication->keyword.c_str(),
+                                    PublicationSet::makeDownloadFileName(
+                                       downloadDirectory, publication->keyword,
+                                       urlMime->value).c_str());
+            }
+            check->Done    = true;
+            check->Skipped = SkippedDownloaded;
+            return check;
+         }
+      }
+      else if(checkNewURLsOnly == true) {
+         if(!quietMode) {
+            check->Log += format("Skipping URL of %s (not a new entry).\n", publication->keyword.c_str());
+         }
+         check->Done    = true;
+         check->Skipped = SkippedNotNew;
+         return check;
+      }
+   }
+
+   // ====== Skip recently checked URLs, according to the cache =============
+   const URLCacheEntry* cacheEntry =
+      (urlCache != nullptr) ? urlCache->find(url->value) : nullptr;
+   if( (recheckAfter > 0) &&
+       (urlCache->isFresh(url->value, cacheEntry, time(nullptr), recheckAfter)) ) {
+      // Restore results missing in the BibTeX entry from the cache:
+      const char* fields[5][2] = {
+         { "url.size",         cacheEntry->Size.c_str()         },
+         { "url.mime",         cacheEntry->MIMEType.c_str()     },
+         { "url.md5",          cacheEntry->MD5.c_str()          },
+         { "url.etag",         cacheEntry->ETag.c_str()         },
+         { "url.lastmodified", cacheEntry->LastModified.c_str() }
+      };
+      for(unsigned int i = 0; i < 5; i++) {
+         if( (fields[i][1][0] != 0x00) && (findChildNode(publication, fields[i][0]) == nullptr) ) {
+            addOrUpdateChildNode(publication, fields[i][0], fields[i][1]);
+         }
+      }
+      if(!quietMode) {
+         check->Log += format("Skipping URL of %s (checked recently).\n", publication->keyword.c_str());
+      }
+      check->Done    = true;
+      check->Skipped = SkippedRecent;
+      return check;
+   }
+
+   // ====== Use conditional requests, if possible ==========================
+   const Node* urlMD5          = findChildNode(publication, "url.md5");
+   const Node* urlETag         = findChildNode(publication, "url.etag");
+   const Node* urlLastModified = findChildNode(publication, "url.lastmodified");
+   if( (downloadDirectory == nullptr) &&
+       (urlSize != nullptr) && (urlMime != nullptr) && (urlMD5 != nullptr) &&
+       ( (urlETag != nullptr) || (urlLastModified != nullptr) ) ) {
+      check->Conditional = true;
+      check->Probing     = headProbe;
+      check->OldSize     = urlSize->value;
+      if(urlETag != nullptr) {
+         check->OldETag = urlETag->value;
+      }
+      if(urlLastModified != nullptr) {
+         check->OldLastModified = urlLastModified->value;
+      }
+   }
+   else if( (downloadDirectory == nullptr) && (cacheEntry != nullptr) &&
+            (urlSize != nullptr) && (urlMime != nullptr) && (urlMD5 != nullptr) &&
+            (cacheEntry->Size == urlSize->value) && (cacheEntry->MD5 == urlMD5->value) &&
+            ( (!cacheEntry->ETag.empty()) || (!cacheEntry->LastModified.empty()) ) ) {
+      // The validators are only in the cache, but for the same content:
+      check->Conditional     = true;
+      check->Probing         = headProbe;
+      check->OldSize         = urlSize->value;
+      check->OldETag         = cacheEntry->ETag;
+      check->OldLastModified = cacheEntry->LastModified;
+   }
+
+   check->Log += format("Checking URL of %s ... ", publication->keyword.c_str());
+   check->ResultLog = check->Log.size();
+   return check;
+}
+
+
+// ###### Check whether a check may share the result of another one #######
+// The requests have to be the same, including the conditional ones.
+static bool canShareResult(const URLCheck* leader, const URLCheck* check)
+{
+   return ( (leader->URL             == check->URL)             &&
+            (leader->Conditional     == check->Conditional)     &&
+            (leader->Probing         == check->Probing)         &&
+            (leader->OldSize         == check->OldSize)         &&
+            (leader->OldETag         == check->OldETag)         &&
+            (leader->OldLastModified == check->OldLastModified) );
+}
+
+
+// ###### Hand over result of a check to a follower #########################
+static void shareResult(const URLCheck* leader, URLCheck* follower)
+{
+   follower->Log += format("[same URL as %s] ", leader->Publication->keyword.c_str());
+   follower->Log += leader->Log.substr(leader->ResultLog);
+   follower->URL            = leader->URL;
+   follower->Good           = leader->Good;
+   follower->NotModified    = leader->NotModified;
+   follower->HTTPStatus     = leader->HTTPStatus;
+   follower->Errors         = leader->Errors;
+   follower->Size           = leader->Size;
+   follower->MD5            = leader->MD5;
+   follower->MIMEType       = leader->MIMEType;
+   follower->Metadata       = leader->Metadata;
+   follower->ETag           = leader->ETag;
+   follower->LastModified   = leader->LastModified;
+   follower->SharedFileName = leader->StoredFileName;
+}
+
+
+// ###### Create temporary file in directory ###############################
+// An anonymous file (O_TMPFILE) is preferred, since it does not need any
+// directory operations until it is linked into place. Otherwise, e.g. on
+// NFS, a named temporary file is used. Linking an anonymous file needs
+// /proc/self/fd, which may be unavailable (e.g. in a chroot).
+static FILE* createTemporaryFile(const char* directory,
+                                 char*       fileName,
+                                 const size_t fileNameSize)
+{
+   int fd = -1;
+   fileName[0] = 0x00;
+#ifdef O_TMPFILE
+   static const bool canLinkAnonymousFiles = (access("/proc/self/fd", X_OK) == 0);
+   if(canLinkAnonymousFiles) {
+      fd = open(directory, O_TMPFILE|O_RDWR, S_IRUSR|S_IWUSR);
+   }
+#endif
+   if(fd < 0) {
+      snprintf(fileName, fileNameSize, "%s/bibtexconv-dXXXXXX", directory);
+      fd = mkstemp(fileName);
+      if(fd < 0) {
+         fileName[0] = 0x00;
+         return nullptr;
+      }
+   }
+   FILE* fh = fdopen(fd, "w+b");
+   if(fh == nullptr) {
+      close(fd);
+      if(fileName[0] != 0x00) {
+         unlink(fileName);
+         fileName[0] = 0x00;
+      }
+   }
+   return fh;
+}
+
+
+// ###### Remove temporary file #############################################
+static void removeTemporaryFile(FILE*& fh, char* fileName)
+{
+   if(fh != nullptr) {
+      fclose(fh);
+      fh = nullptr;
+   }
+   if(fileName[0] != 0x00) {
+      unlink(fileName);
+      fileName[0] = 0x00;
+   }
+}
+
+
+// ###### Copy content of anonymous file into new file #####################
+static bool copyAnonymousFile(const int fd, const char* newFileName)
+{
+   const int newFD = open(newFileName, O_WRONLY|O_CREAT|O_EXCL|O_CLOEXEC, S_IRUSR|S_IWUSR);
+   if(newFD < 0) {
+      return false;
+   }
+   char  buffer[65536];
+   off_t offset  = 0;
+   bool  success = true;
+   for(;;) {
+      const ssize_t bytes = pread(fd, buffer, sizeof(buffer), offset);
+      if(bytes < 0) {
+         if(errno == EINTR) {
+            continue;
+         }
+         success = false;
+         break;
+      }
+      if(bytes == 0) {
+         break;
+      }
+      ssize_t written = 0;
+      while( (success) && (written < bytes) ) {
+         const ssize_t result = write(newFD, &buffer[written], bytes - written);
+         if(result >= 0) {
+            written += result;
+         }
+         else if(errno != EINTR) {
+            success = false;
+         }
+      }
+      if(!success) {
+         break;
+      }
+      offset += bytes;
+   }
+   if(close(newFD) != 0) {
+      success = false;
+   }
+   if(!success) {
+      unlink(newFileName);
+   }
+   return success;
+}
+
+
+// ###### Link temporary file into place, atomically ########################
+// An existing file with the new name is replaced. If an anonymous file
+// cannot be linked, its content is copied.
+static bool linkTemporaryFile(FILE* fh, const char* fileName, const std::string& newFileName)
+{
+   if(fflush(fh) != 0) {
+      return false;
+   }
+   if(fileName[0] != 0x00) {
+      return (rename(fileName, newFileName.c_str()) == 0);
+   }
+
+   char fdPath[64];
+   snprintf((char*)&fdPath, sizeof(fdPath), "/proc/self/fd/%d", fileno(fh));
+   if(linkat(AT_FDCWD, fdPath, AT_FDCWD, newFileName.c_str(), AT_SYMLINK_FOLLOW) == 0) {
+      return true;
+   }
+   // The file exists, or linking is not possible
+   // -> link or copy under temporary name, then rename.
+   const std::string tempFileName = format("%s.%u.tmp", newFileName.c_str(), (unsigned int)getpid());
+   unlink(tempFileName.c_str());
+   if( (linkat(AT_FDCWD, fdPath, AT_FDCWD, tempFileName.c_str(), AT_SYMLINK_FOLLOW) == 0) ||
+       (copyAnonymousFile(fileno(fh), tempFileName.c_str())) ) {
+      if(rename(tempFileName.c_str(), newFileName.c_str()) == 0) {
+         return true;
+      }
+      unlink(tempFileName.c_str());
+   }
+   return false;
+}
+
+
+// ###### Spill the data received so far into a temporary file ##############
+static bool spillToFile(URLCheck* check)
+{
+   check->DownloadFH = createTemporaryFile(
+      (check->DownloadDirectory != nullptr) ? check->DownloadDirectory : "/tmp",
+      (char*)&check->DownloadFileName, sizeof(check->DownloadFileName));
+   if(check->DownloadFH == nullptr) {
+      check->Log += format("ERROR: Failed to create temporary download file: %s!\n", strerror(errno));
+      check->Errors++;
+      return false;
+   }
+   if( (check->Buffer.size() > 0) &&
+       (fwrite(check->Buffer.data(), check->Buffer.size(), 1, check->DownloadFH) != 1) ) {
+      check->Log += format("ERROR: Unable to write download file: %s!\n", strerror(errno));
+      check->Errors++;
+      return false;
+   }
+   check->Buffer.resize(std::min(check->Buffer.size(), MaxPrefixSize));
+   check->Buffer.shrink_to_fit();
+   return true;
+}
+
+
+// ###### Handle received data ##############################################
+size_t URLChecker::writeCallback(char* data, size_t size, size_t nmemb, void* userData)
+{
+   URLCheck*    check  = (URLCheck*)userData;
+   const size_t length = size * nmemb;
+
+   if(check->DownloadFH == nullptr) {
+      check->Buffer.append(data, length);
+      if( (check->Buffer.size() > check->BufferSize) && (!spillToFile(check)) ) {
+         return 0;   // Abort transfer
+      }
+   }
+   else {
+      if(fwrite(data, length, 1, check->DownloadFH) != 1) {
+         check->Log += format("ERROR: Unable to write download file: %s!\n", strerror(errno));
+         check->Errors++;
+         return 0;   // Abort transfer
+      }
+      if(check->Buffer.size() < MaxPrefixSize) {
+         check->Buffer.append(data, std::min(length, MaxPrefixSize - check->Buffer.size()));
+      }
+   }
+   check->Size += length;
+   EVP_DigestUpdate(check->MD5Context, data, length);
+   return length;
+}
+
+
+// ###### Handle received header line #######################################
+size_t URLChecker::headerCallback(char* data, size_t size, size_t nmemb, void* userData)
+{
+   URLCheck*    check  = (URLCheck*)userData;
+   const size_t length = size * nmemb;
+
+   std::string line(data, length);
+   while( (!line.empty()) &&
+          ((line[line.size() - 1] == '\r') || (line[line.size() - 1] == '\n')) ) {
+      line.resize(line.size() - 1);
+   }
+   if(strncmp(line.c_str(), "HTTP/", 5) == 0) {
+      // A new response (e.g. after a redirect) begins:
+      check->ETag.clear();
+      check->LastModified.clear();
+   }
+   else if(strncasecmp(line.c_str(), "ETag:", 5) == 0) {
+      std::string value = line.substr(5);
+      check->ETag = trim(value);
+   }
+   else if(strncasecmp(line.c_str(), "Last-Modified:", 14) == 0) {
+      std::string value = line.substr(14);
+      check->LastModified = trim(value);
+   }
+   return length;
+}
+
+
+// ###### Convert ETag between HTTP and BibTeX representation ###############
+// The quotes of an entity tag would break the BibTeX entry. Therefore,
+// url.etag contains the opaque tag only, with "W/" prefix for a weak tag.
+static std::string etagToBibTeX(const std::string& etag)
+{
+   std::string weak;
+   std::string tag = etag;
+   if(tag.substr(0, 2) == "W/") {
+      weak = "W/";
+      tag  = tag.substr(2);
+   }
+   if( (tag.size() >= 2) && (tag[0] == '"') && (tag[tag.size() - 1] == '"') ) {
+      tag = tag.substr(1, tag.size() - 2);
+   }
+   if( (tag.empty()) || (tag.find_first_of("\"{}\\") != std::string::npos) ) {
+      return "";   // Not usable
+   }
+   return weak + tag;
+}
+
+static std::string etagFromBibTeX(const std::string& etag)
+{
+   if(etag.substr(0, 2) == "W/") {
+      return "W/\"" + etag.substr(2) + "\"";
+   }
+   return "\"" + etag + "\"";
+}
+
+
+// ###### Check whether validators of response match the old ones ##########
+static bool validatorsMatch(const URLCheck* check)
+{
+   if( (!check->OldETag.empty()) && (!check->ETag.empty()) ) {
+      return (etagToBibTeX(check->ETag) == check->OldETag);
+   }
+   if( (!check->OldLastModified.empty()) && (!check->LastModified.empty()) ) {
+      return (check->LastModified == check->OldLastModified);
+   }
+   return false;
+}
+
+
+// ###### Queue check for its next transfer ################################
+// Each host has its own queue, ordered by the position of the checks in
+// the publication set. Retries and follow-up requests (HEAD probe, dynamic
+// URL) therefore get to the front of their host's queue.
+void URLChecker::scheduleCheck(URLCheck* check)
+{
+   check->QueuedAt = getMicroTime();
+   check->Host = getHost(check->URL);
+   std::deque<URLCheck*>& pending = hosts[check->Host].Pending;
+   pending.insert(std::upper_bound(pending.begin(), pending.end(), check,
+                                   [](const URLCheck* a, const URLCheck* b) {
+                                      return (a->Sequence < b->Sequence);
+                                   }),
+                  check);
+}
+
+
+// ###### Start transfers of pending checks #################################
+// A transfer for a host may be started, if the host has less than
+// hostParallelism transfers running, and its next start time (spacing
+// between requests, backoff) has been reached. Among these hosts, the one
+// with the earliest check in the publication set is served first.
+void URLChecker::startTransfers()
+{
+   const unsigned long long now = getMicroTime();
+   while(transfers < parallelism) {
+      HostState* nextHost = nullptr;
+      for(std::pair<const std::string, HostState>& host : hosts) {
+         HostState& hostState = host.second;
+         if( (!hostState.Pending.empty()) &&
+             (hostState.Transfers < hostParallelism) &&
+             (hostState.NextStart <= now) &&
+             ( (nextHost == nullptr) ||
+               (hostState.Pending.front()->Sequence < nextHost->Pending.front()->Sequence) ) ) {
+            nextHost = &hostState;
+         }
+      }
+      if(nextHost == nullptr) {
+         break;
+      }
+      URLCheck* check = nextHost->Pending.front();
+      nextHost->Pending.pop_front();
+      if(!startTransfer(check)) {
+         completeCheck(check);
+      }
+   }
+}
+
+
+// ###### Get time until the next scheduled start of a waiting host #######
+int URLChecker::getSchedulerTimeout(const int maxTimeout) const
+{
+   const unsigned long long now     = getMicroTime();
+   int                      timeout = maxTimeout;
+   if(transfers < parallelism) {
+      for(const std::pair<const std::string, HostState>& host : hosts) {
+         const HostState& hostState = host.second;
+         if( (!hostState.Pending.empty()) &&
+             (hostState.Transfers < hostParallelism) ) {
+            const int wait = (hostState.NextStart > now) ?
+                                (int)std::min((unsigned long long)maxTimeout,
+                                              (hostState.NextStart - now + 999) / 1000) : 0;
+            timeout = std::min(timeout, wait);
+         }
+      }
+   }
+   return timeout;
+}
+
+
+// ###### Start transfer ####################################################
+bool URLChecker::startTransfer(URLCheck* check)
+{
+   // ====== Reset download state ==========================================
+   if(check->MD5Context == nullptr) {
+      check->MD5Context = EVP_MD_CTX_new();
+      if(check->MD5Context == nullptr) {
+         check->Log += "ERROR: Failed to initialize MD5 computation!\n";
+         check->Errors++;
+         return false;
+      }
+   }
+   EVP_DigestInit_ex(check->MD5Context, EVP_md5(), nullptr);
+   check->Timings[TimingQueue] += getMicroTime() - check->QueuedAt;
+   check->Transfers++;
+   check->Size = 0;
+   check->Buffer.clear();
+   removeTemporaryFile(check->DownloadFH, check->DownloadFileName);   // Of previous transfer
+
+   // ====== Set up libcurl easy handle =====================================
+   CURL* curl = curl_easy_init();
+   if(curl == nullptr) {
+      check->Log += "ERROR: Failed to initialize libcurl!\n";
+      check->Errors++;
+      return false;
+   }
+   curl_easy_setopt(curl, CURLOPT_URL,            check->URL.c_str());
+   curl_easy_setopt(curl, CURLOPT_PRIVATE,        (void*)check);
+   curl_easy_setopt(curl, CURLOPT_SHARE,          shareHandle);
+   curl_easy_setopt(curl, CURLOPT_NOSIGNAL,       1L);
+   curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
+   curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 1L);
+   curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION,  writeCallback);
+   curl_easy_setopt(curl, CURLOPT_WRITEDATA,      (void*)check);
+   curl_easy_setopt(curl, CURLOPT_USERAGENT,      "bibtexconv/2.2 (AmigaOS; MC680x0)");
+   curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);   // follow redirects
+   curl_easy_setopt(curl, CURLOPT_AUTOREFERER,    1L);   // set referer on redirect
+   curl_easy_setopt(curl, CURLOPT_COOKIEFILE,     "");   // enable cookies
+   curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 30L);  // 30s connect timeout
+   curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, headerCallback);
+   curl_easy_setopt(curl, CURLOPT_HEADERDATA,     (void*)check);
+
+   // ====== Conditional request, for the URL of the publication only ======
+   if( (check->Conditional) && (check->URL == check->URLNode->value) ) {
+      if(check->Probing) {
+         curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+      }
+      else {
+         if(!check->OldETag.empty()) {
+            check->RequestHeaders = curl_slist_append(check->RequestHeaders,
+               ("If-None-Match: " + etagFromBibTeX(check->OldETag)).c_str());
+         }
+         if(!check->OldLastModified.empty()) {
+            check->RequestHeaders = curl_slist_append(check->RequestHeaders,
+               ("If-Modified-Since: " + check->OldLastModified).c_str());
+         }
+         curl_easy_setopt(curl, CURLOPT_HTTPHEADER, check->RequestHeaders);
+      }
+   }
+   if(curl_multi_add_handle(multiHandle, curl) != CURLM_OK) {
+      check->Log += "ERROR: Failed to add transfer to libcurl!\n";
+      curl_easy_cleanup(curl);
+      check->Errors++;
+      return false;
+   }
+   check->EasyHandle = curl;
+   HostState& hostState = hosts[check->Host];
+   hostState.Transfers++;
+   hostState.NextStart = std::max(hostState.NextStart, getMicroTime() + hostDelay);
+   transfers++;
+   return true;
+}
+
+
+// ###### Handle completed transfer #########################################
+void URLChecker::finishTransfer(URLCheck* check, const CURLcode result)
+{
+   // ====== Clean up transfer ==============================================
+   long       httpErrorCode = 0;
+   curl_off_t contentLength = -1;
+   curl_easy_getinfo(check->EasyHandle, CURLINFO_RESPONSE_CODE, &httpErrorCode);
+   check->HTTPStatus = (result == CURLE_OK) ? (unsigned int)httpErrorCode : 0;
+   curl_easy_getinfo(check->EasyHandle, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &contentLength);
+   const struct {
+      CURLINFO    Info;
+      TimingPhase Phase;
+   } curlTimings[5] = {
+      { CURLINFO_NAMELOOKUP_TIME_T,    TimingNameLookup    },
+      { CURLINFO_CONNECT_TIME_T,       TimingConnect       },
+      { CURLINFO_APPCONNECT_TIME_T,    TimingAppConnect    },
+      { CURLINFO_STARTTRANSFER_TIME_T, TimingStartTransfer },
+      { CURLINFO_TOTAL_TIME_T,         TimingTotal         }
+   };
+   for(unsigned int i = 0; i < 5; i++) {
+      curl_off_t value = 0;
+      if( (curl_easy_getinfo(check->EasyHandle, curlTimings[i].Info, &value) == CURLE_OK) &&
+          (value > 0) ) {
+         check->Timings[curlTimings[i].Phase] += value;
+      }
+   }
+   curl_multi_remove_handle(multiHandle, check->EasyHandle);
+   const bool conditionalRequest = (check->RequestHeaders != nullptr);
+   if(check->RequestHeaders != nullptr) {
+      curl_slist_free_all(check->RequestHeaders);
+      check->RequestHeaders = nullptr;
+   }
+   assert(transfers > 0);
+   transfers--;
+   HostState& hostState = hosts[check->Host];
+   assert(hostState.Transfers > 0);
+   hostState.Transfers--;
+
+   // ====== Back off, if the server is overloaded or throttles us =========
+   if( (result == CURLE_OK) &&
+       ((httpErrorCode == 429) || (httpErrorCode == 503)) &&
+       (check->Retries < retries) ) {
+      curl_off_t retryAfter = -1;
+      curl_easy_getinfo(check->EasyHandle, CURLINFO_RETRY_AFTER, &retryAfter);
+      const unsigned long long delay =
+         (retryAfter > 0) ? (unsigned long long)retryAfter * 1000000ULL :
+                            InitialBackoff << check->Retries;
+      if(delay <= MaxBackoff) {
+         check->Retries++;
+         check->Log += format("[HTTP %u, retry in %llus] ", (unsigned int)httpErrorCode,
+                              (delay + 999999) / 1000000);
+         // The whole host gets a break, not just this check:
+         hostState.NextStart = std::max(hostState.NextStart, getMicroTime() + delay);
+         curl_easy_cleanup(check->EasyHandle);
+         check->EasyHandle = nullptr;
+         scheduleCheck(check);
+         return;
+      }
+   }
+   curl_easy_cleanup(check->EasyHandle);
+   check->EasyHandle = nullptr;
+
+   // ====== Handle HEAD probe =============================================
+   if(check->Probing) {
+      check->Probing = false;
+      if( (result == CURLE_OK) && (httpErrorCode == 200) && (validatorsMatch(check)) &&
+          ( (contentLength < 0) ||
+            (format("%lld", (long long)contentLength) == check->OldSize) ) ) {
+         check->NotModified = true;
+         check->Good        = true;
+         completeCheck(check);
+      }
+      else {   // Changed, or probe failed -> GET
+         scheduleCheck(check);
+      }
+      return;
+   }
+
+   // ====== Check result ===================================================
+   bool resultIsGood = false;
+   if( (result == CURLE_OK) && (conditionalRequest) && (httpErrorCode == 304) ) {
+      check->NotModified = true;
+      check->Good        = true;
+      completeCheck(check);
+      return;
+   }
+   if(result == CURLE_OK) {
+      // ====== Check HTTP result =========================
+      // The actual result is the one of the last request (the request may
+      // have been redirected!)
+      if(strncmp(check->URL.c_str(), "http", 4) == 0) {
+         if(httpErrorCode == 0) {
+            httpErrorCode = 999;
+         }
+         if(httpErrorCode == 200) {
+            resultIsGood = true;
+         }
+         else {
+            check->Log += format("FAILED %s - HTTP returns code %u!\n",
+                                 check->URL.c_str(), (unsigned int)httpErrorCode);
+            check->Errors++;
+         }
+      }
+   }
+   else {
+      check->Log += format("FAILED %s: %s!\n", check->URL.c_str(), curl_easy_strerror(result));
+      check->Errors++;
+   }
+   if(check->DownloadFH != nullptr) {
+      fflush(check->DownloadFH);
+   }
+
+   if(resultIsGood) {
+      // ====== Special handling for dynamic URLs of some publishers ========
+      if(!check->DynamicURLHandled) {
+         check->DynamicURLHandled = true;
+         if(handleDynamicURL(check)) {
+            return;   // A new transfer has been started.
+         }
+      }
+
+      // ====== Finish MD5 computation ======================================
+      unsigned char md5[EVP_MAX_MD_SIZE];
+      unsigned int  md5Length = 0;
+      EVP_DigestFinal_ex(check->MD5Context, (unsigned char*)&md5, &md5Length);
+      for(unsigned int i = 0; i < md5Length; i++) {
+         check->MD5 += format("%02x", (unsigned int)md5[i]);
+      }
+
+      // ====== Hand over to post-processing ================================
+      check->Good = true;
+      std::unique_lock<std::mutex> lock(completionMutex);
+      check->QueuedAt = getMicroTime();
+      postProcessingQueue.push_back(check);
+      postProcessingCondition.notify_one();
+   }
+   else {
+      completeCheck(check);
+   }
+}
+
+
+// ###### Dynamic URL handling ##############################################
+// Returns true, if a new transfer for a dynamic URL has been started.
+bool URLChecker::handleDynamicURL(URLCheck* check)
+{
+   std::string rest;
+   std::string newURL = "";
+
+   // ====== IEEExplore database ============================================
+   if( (hasPrefix(check->URL, "http://ieeexplore.ieee.org/", rest)) ||
+       (hasPrefix(check->URL, "https://ieeexplore.ieee.org/", rest)) ) {
+      if((check->Size > 0) && (check->Size < 65535)) {
+         check->Log += "[IEEExplore";
+
+         const std::string inputString(check->Buffer.c_str());
+         const size_t      framePos = inputString.rfind("<frame src=\"");
+         if(framePos != std::string::npos) {
+            const size_t a = inputString.find("\"", framePos);
+            const size_t b = inputString.find("\"", a + 1);
+            if( (a != std::string::npos) && (b != std::string::npos) ) {
+               newURL = inputString.substr(a + 1, b - a - 1);
+               check->Log += "->" + newURL;
+            }
+         }
+
+         check->Log += "] ";
+      }
+   }
+
+   if(newURL.size() > 0) {
+      check->URL = newURL;
+      scheduleCheck(check);
+      return true;
+   }
+   return false;
+}
+
+
+// ###### Mark check as completed ###########################################
+void URLChecker::completeCheck(URLCheck* check)
+{
+   std::unique_lock<std::mutex> lock(completionMutex);
+   check->Done = true;
+   curl_multi_wakeup(multiHandle);
+}
+
+
+// ###### Post-processing thread ############################################
+void URLChecker::postProcessingWorker()
+{
+   std::unique_lock<std::mutex> lock(completionMutex);
+   while(true) {
+      postProcessingCondition.wait(lock, [this] {
+         return (postProcessingStop || !postProcessingQueue.empty());
+      });
+      if(postProcessingQueue.empty()) {
+         break;
+      }
+      URLCheck* check = postProcessingQueue.front();
+      postProcessingQueue.pop_front();
+      check->Timings[TimingPostProcessingWait] = getMicroTime() - check->QueuedAt;
+
+      lock.unlock();
+      postProcess(check);
+      lock.lock();
+
+      check->Done = true;
+      curl_multi_wakeup(multiHandle);
+   }
+}
+
+
+// ###### Post-process download (size, MD5, MIME type, PDF metadata) #######
+// NOTE: This runs in a worker thread. It must not modify the publication!
+void URLChecker::postProcess(URLCheck* check)
+{
+   if(check->Size == 0) {
+      return;
+   }
+
+   // ====== Compute mime type (in-process, on the prefix) ================
+   const unsigned long long mimeStart = getMicroTime();
+   check->MIMEType = getMIMEType(check->Buffer.data(),
+                                 std::min(check->Buffer.size(), MaxPrefixSize));
+   check->Timings[TimingMIMEType] = getMicroTime() - mimeStart;
+   if(check->MIMEType.empty()) {
+      check->Log += format("WARNING %s: failed to obtain mime type of download file!\n",
+                           check->URLNode->value.c_str());
+   }
+
+   // ====== Get PDF metadata ==============================================
+   if(check->MIMEType == "application/pdf") {
+      const unsigned long long pdfStart    = getMicroTime();
+      bool                     gotMetadata = false;
+      if(check->DownloadFH == nullptr) {
+         gotMetadata = readPDFMetadata(check->Buffer.data(), check->Buffer.size(),
+                                       check->Metadata);
+      }
+      else {
+         void* data = mmap(nullptr, check->Size, PROT_READ, MAP_PRIVATE,
+                           fileno(check->DownloadFH), 0);
+         if(data != MAP_FAILED) {
+            gotMetadata = readPDFMetadata((const char*)data, check->Size, check->Metadata);
+            munmap(data, check->Size);
+         }
+      }
+      if(!gotMetadata) {
+         // The built-in reader failed -> try "pdfinfo" instead.
+         getPDFMetadataFromPDFInfo(check);
+      }
+      check->Timings[TimingPDFMetadata] = getMicroTime() - pdfStart;
+   }
+}
+
+
+// ###### Get PDF metadata using "pdfinfo" ##################################
+// NOTE: This runs in a worker thread. It must not modify the publication!
+void URLChecker::getPDFMetadataFromPDFInfo(URLCheck* check)
+{
+   clearPDFMetadata(check->Metadata);
+
+   // ====== pdfinfo needs a file ===========================================
+   FILE*       pdfFH = nullptr;
+   char        pdfFileName[256];
+   std::string pdfPath;
+   pdfFileName[0] = 0x00;
+   if(check->DownloadFH == nullptr) {
+      pdfFH = createTemporaryFile("/tmp", (char*)&pdfFileName, sizeof(pdfFileName));
+      if( (pdfFH == nullptr) ||
+          (fwrite(check->Buffer.data(), check->Buffer.size(), 1, pdfFH) != 1) ||
+          (fflush(pdfFH) != 0) ) {
+         removeTemporaryFile(pdfFH, (char*)&pdfFileName);
+         return;
+      }
+   }
+   FILE*       fh       = (pdfFH != nullptr) ? pdfFH : check->DownloadFH;
+   const char* fileName = (pdfFH != nullptr) ? pdfFileName : check->DownloadFileName;
+   // An anonymous file is accessible by the child process under its
+   // inherited file descriptor.
+   pdfPath = (fileName[0] != 0x00) ? std::string(fileName) :
+                format("/proc/%u/fd/%d", (unsigned int)getpid(), fileno(fh));
+
+   char metaFileName[256];
+   snprintf((char*)&metaFileName, sizeof(metaFileName), "%s", "/tmp/bibtexconv-pXXXXXX");
+   const int pfd = mkstemp((char*)&metaFileName);
+   if(pfd >= 0) {
+      std::string command = format("pdfinfo %s >%s", pdfPath.c_str(), metaFileName);
+      FILE* metaFH = nullptr;
+      if( (system(command.c_str()) == 0) &&
+          ((metaFH = fdopen(pfd, "r")) != nullptr) ) {
+         while(!feof(metaFH)) {
+            char input[1024];
+            if(fgets((char*)&input, sizeof(input) - 1, metaFH) != nullptr) {
+               if(strncmp(input, "Pages:", 6) == 0) {
+                  check->Metadata.HasPages = true;
+                  check->Metadata.Pages    = atol((const char*)&input[6]);
+               }
+               else if(strncmp(input, "Keywords:", 9) == 0) {
+                  check->Metadata.HasKeywords = true;
+                  check->Metadata.Keywords    = (const char*)&input[9];
+               }
+               else if(strncmp(input, "Page size:", 10) == 0) {
+                  check->Metadata.HasPageSize = true;
+                  check->Metadata.PageSize    = (const char*)&input[10];
+               }
+            }
+         }
+         fclose(metaFH);
+      }
+      else {
+         close(pfd);
+      }
+      unlink(metaFileName);
+   }
+   removeTemporaryFile(pdfFH, (char*)&pdfFileName);
+}
+
+
+// ###### Replace file by a link to another file, atomically ###############
+// A hard link is preferred. If the file system does not support hard links,
+// a symbolic link to linkTarget (relative to the new file) is made instead.
+static bool replaceByLink(const std::string& fileName,
+                          const std::string& linkTarget,
+                          const std::string& newFileName)
+{
+   const std::string tempFileName = format("%s.%u.tmp", newFileName.c_str(), (unsigned int)getpid());
+   unlink(tempFileName.c_str());
+   if( (link(fileName.c_str(), tempFileName.c_str()) != 0) &&
+       (symlink(linkTarget.c_str(), tempFileName.c_str()) != 0) ) {
+      return false;
+   }
+   const bool success = (rename(tempFileName.c_str(), newFileName.c_str()) == 0);
+   // If both names already refer to the same file, rename() does nothing:
+   unlink(tempFileName.c_str());
+   return success;
+}
+
+
+// ###### Store download under its final name ##############################
+// With the content-addressed layout, each content is stored only once, as
+// <directory>/objects/<xx>/<MD5><extension>, with xx being the first two
+// digits of the MD5 sum. The file of a publication is a link to its object.
+// Checks sharing the result of another check link to the already stored
+// data instead of storing it again.
+bool URLChecker::storeDownload(URLCheck* check, const std::string& newFileName)
+{
+   std::string dataFileName = check->SharedFileName;
+   if(dataFileName.empty()) {
+      if(check->Follower) {
+         errno = ENOENT;   // The first check has not stored the data.
+         return false;
+      }
+
+      // ====== Write the data ==============================================
+      std::string storeFileName = newFileName;
+      struct stat status;
+      if(contentAddressedStore) {
+         const std::string objectDirectory =
+            format("%s/objects/%s", downloadDirectory, check->MD5.substr(0, 2).c_str());
+         storeFileName = PublicationSet::makeDownloadFileName(objectDirectory.c_str(),
+                                                              check->MD5, check->MIMEType);
+         if( (stat(storeFileName.c_str(), &status) == 0) &&
+             ((unsigned long long)status.st_size == check->Size) ) {
+            storeFileName.swap(dataFileName);   // Already stored
+         }
+         else {
+            const std::string directories[2] = {
+               format("%s/objects", downloadDirectory), objectDirectory
+            };
+            for(const std::string& directory : directories) {
+               if( (mkdir(directory.c_str(), S_IRWXU|S_IXGRP|S_IRGRP|S_IXOTH|S_IROTH) < 0) &&
+                   (errno != EEXIST) ) {
+                  return false;
+               }
+            }
+         }
+      }
+      if(dataFileName.empty()) {
+         if( (check->DownloadFH == nullptr) && (!spillToFile(check)) ) {
+            return false;
+         }
+         if(!linkTemporaryFile(check->DownloadFH, check->DownloadFileName, storeFileName)) {
+            return false;
+         }
+         check->DownloadFileName[0] = 0x00;   // Renamed, if it had a name
+         dataFileName = storeFileName;
+      }
+      check->StoredFileName = dataFileName;
+      if(dataFileName == newFileName) {
+         return true;
+      }
+   }
+
+   // ====== Link to the stored data ========================================
+   const size_t directoryLength = strlen(downloadDirectory) + 1;
+   return replaceByLink(dataFileName, dataFileName.substr(directoryLength), newFileName);
+}
+
+
+// ###### Set url.checked to current time ###################################
+static void updateCheckTime(Node* publication)
+{
+   const unsigned long long microTime = getMicroTime();
+   const time_t             timeStamp = microTime / 1000000;
+   const tm*                timeptr   = localtime(&timeStamp);
+   char  checkTime[128];
+   strftime((char*)&checkTime, sizeof(checkTime), "%Y-%m-%d %H:%M:%S %Z", timeptr);
+   addOrUpdateChildNode(publication, "url.checked", checkTime);
+}
+
+
+// ###### Apply result of check to publication and print it #################
+unsigned int URLChecker::applyResult(URLCheck* check)
+{
+   Node*        publication = check->Publication;
+   Node*        url         = check->URLNode;
+   unsigned int errors      = check->Errors;
+
+   fputs(check->Log.c_str(), stderr);
+   if(check->Good) {
+      if(check->NotModified) {
+         // ====== Unchanged since the last check ===========================
+         updateCheckTime(publication);
+         fprintf(stderr, "OK (not modified): size=%sB;\ttype=%s;\tMD5=%s\n",
+                 findChildNode(publication, "url.size")->value.c_str(),
+                 findChildNode(publication, "url.mime")->value.c_str(),
+                 findChildNode(publication, "url.md5")->value.c_str());
+      }
+      else if(check->Size > 0) {
+         // ====== Compare size, mime type and MD5 ==========================
+         const std::string& mimeString = check->MIMEType;
+         std::string        sizeString = format("%llu", check->Size);
+         std::string        md5String  = check->MD5;
+         const Node* urlMimeNode = findChildNode(publication, "url.mime");
+         const Node* urlSizeNode = findChildNode(publication, "url.size");
+         const Node* urlMD5Node  = findChildNode(publication, "url.md5");
+
+         bool failed = false;
+         if((urlMimeNode != nullptr) && (urlMimeNode->value != mimeString)) {
+            if( (urlMimeNode->value == "text/html") &&
+                (mimeString == "application/pdf") ) {
+               fprintf(stderr, "\nNOTE: change from HTML to PDF -> just updating entry\n");
+               urlSizeNode = nullptr;
+               urlMD5Node  = nullptr;
+            }
+            else {
+               fprintf(stderr, "UPDATED %s: old mime type has been %s, new type mime is %s\n",
+                       url->value.c_str(),
+                       urlMimeNode->value.c_str(), mimeString.c_str());
+            }
+         }
+         if( (!failed) && (urlSizeNode != nullptr) && (urlSizeNode->value != sizeString) ) {
+             if( (ignoreUpdatesForHTML == true) &&
+                 ((urlMimeNode != nullptr) &&
+                  ((urlMimeNode->value == "text/html") ||
+                   (urlMimeNode->value == "application/xml"))) ) {
+                md5String = "ignore";
+                fprintf(stderr, "[Size change for HTML/XML document -> setting url.md5=\"ignore\"] ");
+             }
+             else {
+               fprintf(stderr, "UPDATED %s: old size has been %s, new size is %s\n",
+                       url->value.c_str(),
+                       urlSizeNode->value.c_str(), sizeString.c_str());
+             }
+         }
+         if( (!failed) && (urlMD5Node != nullptr) && (urlMD5Node->value != "ignore") &&
+            (urlMD5Node->value != md5String)) {
+             if( (ignoreUpdatesForHTML == true) &&
+                 ((urlMimeNode != nullptr) &&
+                  ((urlMimeNode->value == "text/html") ||
+                   (urlMimeNode->value == "application/xml"))) ) {
+                md5String = "ignore";
+                fprintf(stderr, "[MD5 change for HTML/XML document -> setting url.md5=\"ignore\"] ");
+             }
+             else {
+                fprintf(stderr, "UPDATED %s: old MD5 has been %s, new MD5 is %s\n",
+                        url->value.c_str(),
+                        urlMD5Node->value.c_str(), md5String.c_str());
+             }
+         }
+
+         // ====== Update PDF metadata ======================================
+         PDFMetadata& metadata = check->Metadata;
+         if(metadata.HasPages) {
+            addOrUpdateChildNode(publication, "numpages", format("%u", metadata.Pages).c_str());
+         }
+         if(metadata.HasKeywords) {
+            Node* keywords = findChildNode(publication, "keywords");
+            if(keywords == nullptr) {
+               // If there are no "keywords", add "url.keywords".
+               // They can be renamed manually after a check.
+               addOrUpdateChildNode(publication, "url.keywords",
+                                    string2utf8(trim(metadata.Keywords), "~", "").c_str());
+            }
+         }
+         if(metadata.HasPageSize) {
+            addOrUpdateChildNode(publication, "url.pagesize",
+                                 string2utf8(trim(metadata.PageSize), "~", "").c_str());
+         }
+
+         // ====== Update metadata ==========================================
+         if(!failed) {
+            // ====== Update size, mime type and MD5 ========================
+            addOrUpdateChildNode(publication, "url.size", sizeString.c_str());
+            addOrUpdateChildNode(publication, "url.mime", mimeString.c_str());
+            if( (urlMD5Node == nullptr) || (urlMD5Node->value != "ignore")) {
+               addOrUpdateChildNode(publication, "url.md5",  md5String.c_str());
+            }
+
+            // ====== Update validators =====================================
+            if(check->URL == url->value) {
+               const std::string etag = etagToBibTeX(check->ETag);
+               if(!etag.empty()) {
+                  addOrUpdateChildNode(publication, "url.etag", etag.c_str());
+               }
+               if(!check->LastModified.empty()) {
+                  addOrUpdateChildNode(publication, "url.lastmodified",
+                                       check->LastModified.c_str());
+               }
+            }
+
+            // ====== Update check time =====================================
+            updateCheckTime(publication);
+
+            fprintf(stderr, "OK: size=%sB;\ttype=%s;\tMD5=%s\n",
+                    sizeString.c_str(), mimeString.c_str(), md5String.c_str());
+
+            // ====== Store downloaded file =================================
+            if(downloadDirectory != nullptr) {
+               const std::string newFileName =
+                  PublicationSet::makeDownloadFileName(downloadDirectory, publication->keyword, mimeString);
+               if(!storeDownload(check, newFileName)) {
+                  fprintf(stderr, "\nFAILED to store download file %s: %s!\n",
+                          newFileName.c_str(), strerror(errno));
+                  errors++;
+               }
+            }
+         }
+      }
+      else {
+         fprintf(stderr, "\nFAILED %s: size is zero!\n", url->value.c_str());
+         errors++;
+      }
+   }
+
+   if( (urlCache != nullptr) && (!check->Skipped) ) {
+      updateCache(check);
+   }
+   if( (timingReport != nullptr) && (check->Transfers > 0) ) {
+      recordTimings(check);
+   }
+   for(URLCheck* follower : check->Followers) {
+      shareResult(check, follower);
+   }
+
+   // ====== Clean up =======================================================
+   removeTemporaryFile(check->DownloadFH, check->DownloadFileName);
+   if(check->MD5Context != nullptr) {
+      EVP_MD_CTX_free(check->MD5Context);
+      check->MD5Context = nullptr;
+   }
+   return errors;
+}
+
+
+// ###### Store result of check in the cache ################################
+void URLChecker::updateCache(const URLCheck* check)
+{
+   URLCacheEntry        entry;
+   const URLCacheEntry* oldEntry = urlCache->find(check->URLNode->value);
+   if(oldEntry != nullptr) {
+      entry = *oldEntry;
+   }
+   entry.Time   = time(nullptr);
+   entry.Status = 0;
+   if( (check->Good) && ((check->NotModified) || (check->Size > 0)) ) {
+      entry.Status = (check->NotModified) ? 304 : 200;
+      const char* fields[5]  = { "url.size", "url.mime", "url.md5",
+                                 "url.etag", "url.lastmodified" };
+      std::string* values[5] = { &entry.Size, &entry.MIMEType, &entry.MD5,
+                                 &entry.ETag, &entry.LastModified };
+      for(unsigned int i = 0; i < 5; i++) {
+         const Node* node = findChildNode(check->Publication, fields[i]);
+         *values[i] = (node != nullptr) ? node->value : std::string();
+      }
+   }
+   else if(check->HTTPStatus != 200) {
+      entry.Status = check->HTTPStatus;   // Otherwise 0: no usable content
+   }
+   urlCache->update(check->URLNode->value, entry);
+}
+
+
+// ###### Names of the timing phases ########################################
+static const char* TimingPhaseNames[URLChecker::TimingPhases] = {
+   "queue",
+   "namelookup",
+   "connect",
+   "appconnect",
+   "starttransfer",
+   "total",
+   "postprocessing_wait",
+   "mime",
+   "pdfmetadata"
+};
+
+
+// ###### Record timings of a check #########################################
+void URLChecker::recordTimings(const URLCheck* check)
+{
+   URLTiming timing;
+   timing.Anchor     = check->Publication->keyword;
+   timing.URL        = check->URLNode->value;
+   timing.Host       = getHost(check->URLNode->value);
+   timing.HTTPStatus = check->HTTPStatus;
+   timing.Transfers  = check->Transfers;
+   timing.Size       = check->Size;
+   for(unsigned int i = 0; i < TimingPhases; i++) {
+      timing.Phases[i] = check->Timings[i];
+   }
+   timings.push_back(timing);
+}
+
+
+// ###### Write timing report (CSV, or JSON for *.json) #####################
+bool URLChecker::writeTimingReport() const
+{
+   const size_t length = strlen(timingReport);
+   const bool   json   = ( (length >= 5) && (strcmp(&timingReport[length - 5], ".json") == 0) );
+   FILE* fh = fopen(timingReport, "w");
+   if(fh == nullptr) {
+      fprintf(stderr, "ERROR: Unable to create timing report %s: %s!\n",
+              timingReport, strerror(errno));
+      return false;
+   }
+
+   if(json) {
+      fputs("[\n", fh);
+   }
+   else {
+      fputs("anchor,url,host,status,size,transfers", fh);
+      for(unsigned int i = 0; i < TimingPhases; i++) {
+         fprintf(fh, ",%s_ms", TimingPhaseNames[i]);
+      }
+      fputs("\n", fh);
+   }
+   for(size_t t = 0; t < timings.size(); t++) {
+      const URLTiming& timing = timings[t];
+      if(json) {
+         fprintf(fh, "   { \"anchor\": \"%s\", \"url\": \"%s\", \"host\": \"%s\", "
+                     "\"status\": %u, \"size\": %llu, \"transfers\": %u",
+                 string2json(timing.Anchor).c_str(), string2json(timing.URL).c_str(),
+                 string2json(timing.Host).c_str(),
+                 timing.HTTPStatus, timing.Size, timing.Transfers);
+         for(unsigned int i = 0; i < TimingPhases; i++) {
+            fprintf(fh, ", \"%s_ms\": %1.3f", TimingPhaseNames[i], timing.Phases[i] / 1000.0);
+         }
+         fputs((t + 1 < timings.size()) ? " },\n" : " }\n", fh);
+      }
+      else {
+         std::string url = timing.URL;
+         replaceAll(url, "\"", "\"\"");
+         fprintf(fh, "%s,\"%s\",%s,%u,%llu,%u",
+                 timing.Anchor.c_str(), url.c_str(), timing.Host.c_str(),
+                 timing.HTTPStatus, timing.Size, timing.Transfers);
+         for(unsigned int i = 0; i < TimingPhases; i++) {
+            fprintf(fh, ",%1.3f", timing.Phases[i] / 1000.0);
+         }
+         fputs("\n", fh);
+      }
+   }
+   if(json) {
+      fputs("]\n", fh);
+   }
+
+   const bool success = (ferror(fh) == 0);
+   if( (fclose(fh) != 0) || (!success) ) {
+      fprintf(stderr, "ERROR: Unable to write timing report %s!\n", timingReport);
+      return false;
+   }
+   return true;
+}
+
+
+// ###### Print summary of timings ##########################################
+// Percentiles are computed by the nearest-rank method.
+void URLChecker::printTimingSummary(const size_t firstTiming) const
+{
+   const size_t count = timings.size() - firstTiming;
+   if(count == 0) {
+      return;
+   }
+
+   // ====== Percentiles of each phase ======================================
+   fprintf(stderr, "URL check timings of %u checks (in ms):\n", (unsigned int)count);
+   fprintf(stderr, "   %-20s %10s %10s %10s %10s\n", "phase", "p50", "p90", "p99", "max");
+   std::vector<unsigned long long> values(count);
+   for(unsigned int i = 0; i < TimingPhases; i++) {
+      for(size_t t = 0; t < count; t++) {
+         values[t] = timings[firstTiming + t].Phases[i];
+      }
+      std::sort(values.begin(), values.end());
+      fprintf(stderr, "   %-20s", TimingPhaseNames[i]);
+      const unsigned int percentiles[3] = { 50, 90, 99 };
+      for(unsigned int p = 0; p < 3; p++) {
+         const size_t rank = std::max((size_t)1, (count * percentiles[p] + 99) / 100);
+         fprintf(stderr, " %10.1f", values[rank - 1] / 1000.0);
+      }
+      fprintf(stderr, " %10.1f\n", values[count - 1] / 1000.0);
+   }
+
+   // ====== Slowest hosts, by mean total time ==============================
+   std::map<std::string, std::pair<unsigned long long, unsigned int>> hostTimes;
+   for(size_t t = firstTiming; t < timings.size(); t++) {
+      std::pair<unsigned long long, unsigned int>& hostTime = hostTimes[timings[t].Host];
+      hostTime.first += timings[t].Phases[TimingTotal];
+      hostTime.second++;
+   }
+   std::vector<std::pair<double, std::string>> slowestHosts;
+   for(const std::pair<const std::string, std::pair<unsigned long long, unsigned int>>& hostTime : hostTimes) {
+      slowestHosts.push_back(std::pair<double, std::string>(
+         (double)hostTime.second.first / hostTime.second.second, hostTime.first));
+   }
+   std::sort(slowestHosts.begin(), slowestHosts.end(),
+             [](const std::pair<double, std::string>& a, const std::pair<double, std::string>& b) {
+                return (a.first > b.first);
+             });
+   fputs("Slowest hosts (mean total time):\n", stderr);
+   for(size_t h = 0; h < std::min((size_t)5, slowestHosts.size()); h++) {
+      fprintf(stderr, "   %-40s %10.1f ms (%u checks)\n",
+              slowestHosts[h].second.c_str(), slowestHosts[h].first / 1000.0,
+              hostTimes[slowestHosts[h].second].second);
+   }
+}
+
+
+// ###### List files in download directory ##################################
+// The download directory is listed once per checkAll(), instead of testing
+// the existence of each download file, which may be slow (e.g. on NFS).
+bool URLChecker::listDownloadDirectory()
+{
+   downloadFiles.clear();
+   DIR* directory = opendir(downloadDirectory);
+   if(directory == nullptr) {
+      fprintf(stderr, "ERROR: Failed to read download directory: %s!\n",
+              strerror(errno));
+      return false;
+   }
+   const dirent* entry;
+   while( (entry = readdir(directory)) != nullptr ) {
+      if(entry->d_type != DT_DIR) {
+         downloadFiles.insert(entry->d_name);
+      }
+   }
+   closedir(directory);
+   return true;
+}
+
+
+// ###### Check URLs ########################################################
+unsigned int URLChecker::checkAll(PublicationSet* publicationSet)
+{
+   if(downloadDirectory != nullptr) {
+      if( (mkdir(downloadDirectory, S_IRWXU|S_IXGRP|S_IRGRP|S_IXOTH|S_IROTH) < 0) &&
+          (errno != EEXIST) ) {
+         fprintf(stderr, "ERROR: Failed to create download directory: %s!\n",
+                 strerror(errno));
+         return 1;
+      }
+      if(!listDownloadDirectory()) {
+         return 1;
+      }
+   }
+
+   multiHandle = curl_multi_init();
+   shareHandle = curl_share_init();
+   if( (multiHandle == nullptr) || (shareHandle == nullptr) ) {
+      fputs("ERROR: Failed to initialize libcurl!\n", stderr);
+      if(multiHandle) {
+         curl_multi_cleanup(multiHandle);
+         multiHandle = nullptr;
+      }
+      if(shareHandle) {
+         curl_share_cleanup(shareHandle);
+         shareHandle = nullptr;
+      }
+      return 1;
+   }
+   // With CURLOPT_NOSIGNAL, libcurl does not ignore SIGPIPE itself. Writing
+   // to a socket closed by the peer (e.g. within the TLS library) must not
+   // kill the program:
+   void (*oldSIGPIPEHandler)(int) = signal(SIGPIPE, SIG_IGN);
+
+   // All transfers share the cookies, like a single browser session:
+   curl_share_setopt(shareHandle, CURLSHOPT_SHARE, CURL_LOCK_DATA_COOKIE);
+   curl_share_setopt(shareHandle, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+
+   // ====== Plan checks, in order of the publication set ===================
+   // The whole work list is decided before any network activity starts.
+   // Each URL is only transferred once. Further checks of the same URL are
+   // followers of the first one, getting its result. Publications already
+   // checked in this run (e.g. by a previous export) are not checked again.
+   std::vector<URLCheck*>           checks;
+   std::map<std::string, URLCheck*> firstChecks;
+   unsigned int                     planned[4]     = { 0, 0, 0, 0 };   // By SkipReason
+   unsigned int                     followers      = 0;
+   unsigned int                     alreadyChecked = 0;
+   for(size_t index = 0; index < publicationSet->size(); index++) {
+      if(publicationSet->get(index)->value == "Comment") {
+         continue;
+      }
+      Node* publication = publicationSet->get(index);
+      Node* url         = findChildNode(publication, "url");
+      if(url == nullptr) {
+         continue;
+      }
+      if(publication->urlChecked) {
+         alreadyChecked++;
+         continue;
+      }
+      publication->urlChecked = true;
+      URLCheck* check = prepareCheck(publication, url);
+      check->Sequence = checks.size();
+      checks.push_back(check);
+      planned[check->Skipped]++;
+      if(!check->Done) {
+         std::map<std::string, URLCheck*>::iterator found = firstChecks.find(check->URL);
+         if( (found != firstChecks.end()) && (canShareResult(found->second, check)) ) {
+            found->second->Followers.push_back(check);
+            check->Follower = true;
+            check->Done     = true;   // Applied after the first check
+            followers++;
+         }
+         else {
+            firstChecks.insert(std::pair<std::string, URLCheck*>(check->URL, check));
+         }
+      }
+   }
+   downloadFiles.clear();
+   if( (!quietMode) && (!checks.empty()) ) {
+      fprintf(stderr, "URL check plan: %u to check (%u with the same URL as another entry), "
+                      "%u already downloaded, %u not new, %u checked recently",
+              planned[NotSkipped], followers, planned[SkippedDownloaded],
+              planned[SkippedNotNew], planned[SkippedRecent]);
+      if(alreadyChecked > 0) {
+         fprintf(stderr, ", %u already checked in this run", alreadyChecked);
+      }
+      fputs(".\n", stderr);
+   }
+
+   // ====== Hand the work list over to the transfer scheduler ==============
+   for(URLCheck* check : checks) {
+      if(!check->Done) {
+         scheduleCheck(check);
+      }
+   }
+
+   // ====== Start post-processing threads ==================================
+   const size_t firstTiming = timings.size();
+   postProcessingStop = false;
+   std::vector<std::thread> postProcessingThreads;
+   const unsigned int workers = std::max(1U, std::min(parallelism, getNumberOfWorkers()));
+   for(unsigned int i = 0; i < workers; i++) {
+      postProcessingThreads.push_back(std::thread(&URLChecker::postProcessingWorker, this));
+   }
+
+   // ====== Main loop: perform transfers, apply results in order ===========
+   unsigned int errors      = 0;
+   size_t       nextToApply = 0;
+   while(nextToApply < checks.size()) {
+      startTransfers();
+
+      int runningTransfers;
+      curl_multi_perform(multiHandle, &runningTransfers);
+      CURLMsg* message;
+      int      queuedMessages;
+      while( (message = curl_multi_info_read(multiHandle, &queuedMessages)) != nullptr ) {
+         if(message->msg == CURLMSG_DONE) {
+            char* privateData = nullptr;
+            curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, &privateData);
+            finishTransfer((URLCheck*)privateData, message->data.result);
+         }
+      }
+
+      std::vector<URLCheck*> completedChecks;
+      {
+         std::unique_lock<std::mutex> lock(completionMutex);
+         while( (nextToApply < checks.size()) && (checks[nextToApply]->Done) ) {
+            completedChecks.push_back(checks[nextToApply++]);
+         }
+      }
+      for(URLCheck* check : completedChecks) {
+         errors += applyResult(check);
+         delete check;
+      }
+
+      if( (completedChecks.empty()) && (nextToApply < checks.size()) ) {
+         curl_multi_poll(multiHandle, nullptr, 0, getSchedulerTimeout(1000), nullptr);
+      }
+   }
+
+   // ====== Clean up =======================================================
+   {
+      std::unique_lock<std::mutex> lock(completionMutex);
+      postProcessingStop = true;
+      postProcessingCondition.notify_all();
+   }
+   for(std::thread& thread : postProcessingThreads) {
+      thread.join();
+   }
+   assert(transfers == 0);
+   hosts.clear();
+   curl_multi_cleanup(multiHandle);
+   multiHandle = nullptr;
+   curl_share_cleanup(shareHandle);
+   shareHandle = nullptr;
+   signal(SIGPIPE, oldSIGPIPEHandler);
+
+   if( (urlCache != nullptr) && (!urlCache->save()) ) {
+      errors++;
+   }
+   if(timingReport != nullptr) {
+      printTimingSummary(firstTiming);
+      if(!writeTimingReport()) {
+         errors++;
+      }
+   }
+
+   return errors;
+}
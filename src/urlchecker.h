@@ -0,0 +1,189 @@
+// ==========================================================================
+//                ____  _ _   _____   __  ______
+//                | __ )(_) |_|_   _|__\ \/ / ___|___  _ ____   __
+//                |  _ \| | '_ \| |/ _ \  / |   / _ \| '_ \ \ / /
+//                | |_) | | |_) | |  __//  \ |__| (_) | | | \ V /
+//                |____/|_|_.__/|_|\___/_/\_\____\___/|_| |_|\_/
+//
+//                          ---  BibTeX Converter  ---
+//                   https://www.nntb.no/~dreibh/bibtexconv/
+// ==========================================================================
+//
+// BibTeX Converter
+// Copyright (C) 2010-2026 by Thomas Dreibholz
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Contact: thomas.dreibholz@gmail.com
+
+#ifndef URLCHECKER_H
+#define URLCHECKER_H
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <curl/curl.h>
+
+#include "node.h"
+#include "publicationset.h"
+#include "urlcache.h"
+
+
+struct URLCheck;
+
+// URLChecker checks the URLs of a publication set. Up to "parallelism"
+// transfers (at most "hostParallelism" per host, started at least
+// "hostDelay" apart) are performed concurrently, using the libcurl multi
+// interface. A host answering 429 or 503 gets an exponential backoff. Completed downloads are
+// post-processed (size, MD5, MIME type, PDF metadata) by worker threads.
+// The results are applied to the publications, and printed, in the order
+// of the publication set. Each URL is only transferred once per run.
+class URLChecker
+{
+   public:
+   URLChecker();
+   ~URLChecker();
+
+   inline void setDownloadDirectory(const char* directory) {
+      downloadDirectory = directory;
+   }
+   inline void setContentAddressedStore(const bool contentAddressed) {
+      contentAddressedStore = contentAddressed;
+   }
+   inline void setCheckNewURLsOnly(const bool newURLsOnly) {
+      checkNewURLsOnly = newURLsOnly;
+   }
+   inline void setIgnoreUpdatesForHTML(const bool ignoreUpdates) {
+      ignoreUpdatesForHTML = ignoreUpdates;
+   }
+   inline void setQuietMode(const bool quiet) {
+      quietMode = quiet;
+   }
+   inline void setParallelism(const unsigned int transfers) {
+      parallelism = (transfers > 0) ? transfers : 1;
+   }
+   inline void setHostParallelism(const unsigned int transfers) {
+      hostParallelism = (transfers > 0) ? transfers : 1;
+   }
+   inline void setHeadProbe(const bool probe) {
+      headProbe = probe;
+   }
+   inline void setCache(URLCache* cache) {
+      urlCache = cache;
+   }
+   inline void setRecheckAfter(const unsigned int seconds) {
+      recheckAfter = seconds;
+   }
+   inline void setHostDelay(const unsigned int milliseconds) {
+      hostDelay = 1000ULL * milliseconds;
+   }
+   inline void setRetries(const unsigned int maxRetries) {
+      retries = maxRetries;
+   }
+   inline void setBufferSize(const size_t bytes) {
+      bufferSize = bytes;
+   }
+   inline void setTimingReport(const char* reportFileName) {
+      timingReport = reportFileName;
+   }
+
+   // Phases of a check, for the timing report:
+   enum TimingPhase {
+      TimingQueue              = 0,   // Waiting for transfer start (incl. backoff)
+      TimingNameLookup         = 1,   // From curl ...
+      TimingConnect            = 2,
+      TimingAppConnect         = 3,
+      TimingStartTransfer      = 4,
+      TimingTotal              = 5,   // ... to here
+      TimingPostProcessingWait = 6,   // Waiting for a post-processing thread
+      TimingMIMEType           = 7,
+      TimingPDFMetadata        = 8,
+      TimingPhases             = 9
+   };
+
+   unsigned int checkAll(PublicationSet* publicationSet);
+
+   private:
+   static size_t writeCallback(char* data, size_t size, size_t nmemb, void* userData);
+   static size_t headerCallback(char* data, size_t size, size_t nmemb, void* userData);
+   bool listDownloadDirectory();
+   URLCheck* prepareCheck(Node* publication, Node* url);
+   void scheduleCheck(URLCheck* check);
+   void startTransfers();
+   int getSchedulerTimeout(const int maxTimeout) const;
+   bool startTransfer(URLCheck* check);
+   void finishTransfer(URLCheck* check, const CURLcode result);
+   bool handleDynamicURL(URLCheck* check);
+   void postProcessingWorker();
+   void postProcess(URLCheck* check);
+   void getPDFMetadataFromPDFInfo(URLCheck* check);
+   bool storeDownload(URLCheck* check, const std::string& newFileName);
+   void completeCheck(URLCheck* check);
+   unsigned int applyResult(URLCheck* check);
+   void updateCache(const URLCheck* check);
+   void recordTimings(const URLCheck* check);
+   bool writeTimingReport() const;
+   void printTimingSummary(const size_t firstTiming) const;
+
+   const char*                         downloadDirectory;
+   bool                                contentAddressedStore;
+   bool                                checkNewURLsOnly;
+   bool                                ignoreUpdatesForHTML;
+   bool                                quietMode;
+   unsigned int                        parallelism;
+   unsigned int                        hostParallelism;
+   bool                                headProbe;
+   URLCache*                           urlCache;
+   unsigned int                        recheckAfter;
+   unsigned long long                  hostDelay;   // in us
+   unsigned int                        retries;
+   size_t                              bufferSize;
+   const char*                         timingReport;
+
+   struct URLTiming {
+      std::string                      Anchor;
+      std::string                      URL;
+      std::string                      Host;
+      unsigned int                     HTTPStatus;
+      unsigned int                     Transfers;
+      unsigned long long               Size;
+      unsigned long long               Phases[TimingPhases];   // in us
+   };
+   std::vector<URLTiming>              timings;
+
+   // ====== State of checkAll() ============================================
+   std::unordered_set<std::string>     downloadFiles;   // In download directory
+   CURLM*                              multiHandle;
+   CURLSH*                             shareHandle;
+   struct HostState {
+      HostState() : Transfers(0), NextStart(0) { }
+      std::deque<URLCheck*> Pending;     // Checks waiting for a transfer
+      unsigned int          Transfers;   // Running transfers
+      unsigned long long    NextStart;   // Earliest time for next transfer
+   };
+   std::map<std::string, HostState>    hosts;
+   unsigned int                        transfers;
+
+   std::mutex                          completionMutex;
+   std::condition_variable             postProcessingCondition;
+   std::deque<URLCheck*>               postProcessingQueue;
+   bool                                postProcessingStop;
+};
+
+#endif
@@ -0,0 +1,84 @@
+// ==========================================================================
+//                ____  _ _   _____   __  ______
+//                | __ )(_) |_|_   _|__\ \/ / ___|___  _ ____   __
+//                |  _ \| | '_ \| |/ _ \  / |   / _ \| '_ \ \ / /
+//                | |_) | | |_) | |  __//  \ |__| (_) | | | \ V /
+//                |____/|_|_.__/|_|\___/_/\_\____\___/|_| |_|\_/
+//
+//                          ---  BibTeX Converter  ---
+//                   https://www.nntb.no/~dreibh/bibtexconv/
+// ==========================================================================
+//
+// BibTeX Converter
+// Copyright (C) 2010-2026 by Thomas Dreibholz
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// Contact: thomas.dreibholz@gmail.com
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "workerpool.h"
+
+
+// ###### Get number of worker threads to use ###############################
+unsigned int getNumberOfWorkers()
+{
+   const unsigned int cores = std::thread::hardware_concurrency();
+   return (cores > 0) ? cores : 1;
+}
+
+
+// ###### Call function for all items, using multiple threads ###############
+// The function is called exactly once for each index in [0, items). The
+// order of the calls is undefined, i.e. the function has to store its
+// results by index if the caller needs them in a deterministic order.
+void runInParallel(const size_t                              items,
+                   const std::function<void(const size_t)>& function,
+                   const unsigned int                        maxWorkers)
+{
+   size_t workers = (maxWorkers > 0) ? maxWorkers : getNumberOfWorkers();
+   if(workers > items) {
+      workers = items;
+   }
+
+   // ====== Just one worker -> no need for threads ========================
+   if(workers <= 1) {
+      for(size_t i = 0; i < items; i++) {
+         function(i);
+      }
+      return;
+   }
+
+   // ====== Distribute the work ============================================
+   std::atomic<size_t> nextItem(0);
+   auto worker = [&]() {
+      size_t i;
+      while( (i = nextItem.fetch_add(1)) < items ) {
+         function(i);
+      }
+   };
+
+   std::vector<std::thread> threads;
+   threads.reserve(workers - 1);
+   for(size_t w = 1; w < workers; w++) {
+      threads.emplace_back(worker);
+   }
+   worker();   // The calling thread also takes part.
+   for(std::thread& thread : threads) {
+      thread.join();
+   }
+}